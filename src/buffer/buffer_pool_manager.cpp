@@ -1,4 +1,12 @@
+#include <algorithm>
+#include <new>
+#include <sys/mman.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
 #include "common/logger.h"
 
 namespace cmudb {
@@ -6,39 +14,130 @@ namespace cmudb {
 /*
  * BufferPoolManager Constructor
  * When log_manager is nullptr, logging is disabled (for test purpose)
- * WARNING: Do Not Edit This Function
+ * num_instances: number of independent partitions the pool is split into,
+ * pool_size frames are spread as evenly as possible among them
+ * replacer_type: replacement policy used by every instance
+ * use_huge_pages: back the frames with huge pages, reserved ones if the system
+ * has any, transparent ones otherwise. Saves TLB misses on large pools
+ * On a read only disk manager all of them are ignored, the pool only makes
+ * views of mapped pages
  */
 BufferPoolManager::BufferPoolManager(size_t pool_size,
                                                  DiskManager *disk_manager,
-                                                 LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager),
-      log_manager_(log_manager) {
-  // a consecutive memory space for buffer pool
+                                                 LogManager *log_manager,
+                                                 size_t num_instances,
+                                                 ReplacerType replacer_type,
+                                                 bool use_huge_pages)
+    : pool_size_(pool_size), num_instances_(num_instances),
+      disk_manager_(disk_manager), log_manager_(log_manager) {
+  if (disk_manager_->IsReadOnly()) {
+    mapped_ = true;
+    pool_size_ = 0;
+    num_instances_ = 0;
+    num_mapped_pages_ = disk_manager_->GetNumPages();
+    size_t numChunks =
+        (num_mapped_pages_ + MAPPED_CHUNK_PAGES - 1) / MAPPED_CHUNK_PAGES;
+    mapped_chunks_ = new std::atomic<MappedChunk *>[numChunks];
+    for (size_t i = 0; i < numChunks; ++i) {
+      mapped_chunks_[i] = nullptr;
+    }
+    return;
+  }
+  assert(num_instances_ > 0 && num_instances_ <= pool_size_);
+  // a consecutive memory space for buffer pool. The frames are one anonymous
+  // mapping: zeroed, page aligned and so every frame is aligned at least as
+  // much as O_DIRECT I/O needs
+  int page_size = disk_manager_->GetPageSize();
+  frames_size_ = pool_size_ * page_size;
+  void *frames = MAP_FAILED;
+  if (use_huge_pages) {
+    frames_size_ = (frames_size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE *
+                   HUGE_PAGE_SIZE;
+    frames = mmap(nullptr, frames_size_, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    huge_tlb_ = frames != MAP_FAILED;
+  }
+  if (frames == MAP_FAILED) {
+    frames = mmap(nullptr, frames_size_, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (frames == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    if (use_huge_pages) {
+      madvise(frames, frames_size_, MADV_HUGEPAGE);
+    }
+  }
+  frames_ = static_cast<char *>(frames);
   pages_ = new Page[pool_size_];
-  page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
-  replacer_ = new LRUReplacer<Page *>;
-  free_list_ = new std::list<Page *>;
-
-  // put all the pages into free list
   for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_->push_back(&pages_[i]);
+    pages_[i].data_ = frames_ + i * page_size;
+    pages_[i].page_size_ = page_size;
+  }
+  instances_ = new BufferPoolInstance[num_instances_];
+
+  size_t offset = 0;
+  for (size_t i = 0; i < num_instances_; ++i) {
+    BufferPoolInstance &instance = instances_[i];
+    instance.pool_size_ =
+        pool_size_ / num_instances_ + (i < pool_size_ % num_instances_ ? 1 : 0);
+    instance.pages_ = pages_ + offset;
+    instance.page_table_ =
+        new OpenAddressHash<page_id_t, Page *>(instance.pool_size_);
+    if (replacer_type == ReplacerType::CLOCK) {
+      instance.replacer_ =
+          new ClockReplacer<Page *>(instance.pool_size_, instance.pages_);
+    } else if (replacer_type == ReplacerType::LRUK) {
+      instance.replacer_ = new LRUKReplacer<Page *>(
+          instance.pool_size_, LRUK_REPLACER_K, instance.pages_);
+    } else {
+      instance.replacer_ = new LRUReplacer<Page *>;
+    }
+    instance.free_list_ = new std::list<Page *>;
+
+    // put all the pages into free list
+    for (size_t j = 0; j < instance.pool_size_; ++j) {
+      instance.free_list_->push_back(&instance.pages_[j]);
+    }
+    offset += instance.pool_size_;
   }
 }
 
 /*
  * BufferPoolManager Deconstructor
- * WARNING: Do Not Edit This Function
  */
 BufferPoolManager::~BufferPoolManager() {
+  StopCleanerThread();
+  if (prefetch_thread_ != nullptr) {
+    {
+      std::lock_guard<std::mutex> guard(prefetch_latch_);
+      prefetch_running_ = false;
+    }
+    prefetch_cv_.notify_one();
+    prefetch_thread_->join();
+    delete prefetch_thread_;
+  }
+  for (size_t i = 0; i < num_instances_; ++i) {
+    delete instances_[i].page_table_;
+    delete instances_[i].replacer_;
+    delete instances_[i].free_list_;
+  }
+  delete[] instances_;
   delete[] pages_;
-  delete page_table_;
-  delete replacer_;
-  delete free_list_;
+  if (frames_ != nullptr) {
+    munmap(frames_, frames_size_);
+  }
+  if (mapped_) {
+    for (size_t i = 0; i * MAPPED_CHUNK_PAGES < num_mapped_pages_; ++i) {
+      delete mapped_chunks_[i].load();
+    }
+    delete[] mapped_chunks_;
+  }
 }
 
 /**
  * 1. search hash table.
- *  1.1 if exist, pin the page and return immediately
+ *  1.1 if exist, pin the page and return immediately (without the instance
+ *  latch)
  *  1.2 if no exist, find a replacement entry from either free list or lru
  * replacer. (NOTE: always find from free list first)
  * 2. If the entry chosen for replacement is dirty, write it back to disk.
@@ -46,33 +145,76 @@ BufferPoolManager::~BufferPoolManager() {
  * entry for the new page.
  * 4. Update page metadata, read page content from disk file and return page
  * pointer
+ * Steps 2 and 4 run after the instance latch is released. Until they are done
+ * the frame is marked io pending, and anyone else fetching the same page waits
+ * on that frame only.
+ * If a strategy is given, the replacement entry of step 1.2 comes from its
+ * ring when possible.
+ * If step 4 fails, the frame is given up and everyone waiting for it gets
+ * the exception, a later fetch reads the page again.
+ * A read only pool skips all of it, see fetchMapped().
  */
-Page *BufferPoolManager::FetchPage(page_id_t page_id) {
-    std::lock_guard<std::mutex> guard(latch_);
-
-    Page *targetPage = nullptr;
-    if (page_table_->Find(page_id, targetPage)) {
-        // already in memory
-        targetPage->pin_count_++;
-        // replacer only record those Page pin_count == 0
-        replacer_->Erase(targetPage);
-        return targetPage;
-    } else {
-        targetPage = findUnusedPage();
+Page *BufferPoolManager::FetchPage(page_id_t page_id,
+                                   BufferAccessStrategy *strategy) {
+    if (mapped_) {
+        return fetchMapped(page_id);
+    }
+    BufferPoolInstance &instance = GetInstance(page_id);
+    Page *targetPage = nullptr;
+    if (instance.page_table_->Find(page_id, targetPage) &&
+        pinPage(instance, targetPage, page_id)) {
+        instance.replacer_->RecordAccess(targetPage);
+        instance.num_hits_.fetch_add(1, std::memory_order_relaxed);
+        waitForIO(targetPage);
+        return checkRead(instance, targetPage, page_id);
+    }
 
-        if (targetPage == nullptr) {
-            return targetPage;
-        }
+    std::unique_lock<std::mutex> lock(instance.latch_);
+    while (!instance.page_table_->Find(page_id, targetPage)) {
+        Page *victim = findWritingBack(instance, page_id);
+        if (victim == nullptr) {
+            page_id_t victimPageId;
+            targetPage = findUnusedPage(instance, victimPageId, strategy);
 
-        disk_manager_->ReadPage(page_id, targetPage->GetData());
-        targetPage->pin_count_ = 1;
-        targetPage->page_id_ = page_id;
+            if (targetPage == nullptr) {
+                return targetPage;
+            }
+            if (strategy != nullptr) {
+                strategy->ring_[strategy->current_] = targetPage;
+                strategy->ring_page_ids_[strategy->current_] = page_id;
+            }
 
-        page_table_->Insert(page_id, targetPage);
+            targetPage->page_id_ = page_id;
+            targetPage->io_pending_ = true;
+            targetPage->io_latch_.lock();
+            // from here on the frame can be pinned by readers, who wait for
+            // the read to finish
+            targetPage->pin_count_ = 1;
 
-        assert(!targetPage->is_dirty_);
+            instance.page_table_->Insert(page_id, targetPage);
+            instance.replacer_->RecordAccess(targetPage);
+            instance.num_misses_.fetch_add(1, std::memory_order_relaxed);
+
+            assert(!targetPage->is_dirty_);
+            lock.unlock();
+            finishIO(instance, targetPage, victimPageId, true);
+            return checkRead(instance, targetPage, page_id);
+        }
+        // an evicted copy of this page is still on its way to disk, only read
+        // it back once that write has finished
+        lock.unlock();
+        waitForIO(victim);
+        lock.lock();
     }
-    return targetPage;
+
+    // brought in by someone else meanwhile. Under the latch the frame can not
+    // be changing pages, pinning always succeeds
+    pinPage(instance, targetPage, page_id);
+    instance.replacer_->RecordAccess(targetPage);
+    instance.num_hits_.fetch_add(1, std::memory_order_relaxed);
+    lock.unlock();
+    waitForIO(targetPage);
+    return checkRead(instance, targetPage, page_id);
 }
 
 /*
@@ -80,25 +222,35 @@ Page *BufferPoolManager::FetchPage(page_id_t page_id) {
  * if pin_count>0, decrement it and if it becomes zero, put it back to
  * replacer if pin_count<=0 before this call, return false. is_dirty: set the
  * dirty flag of this page
+ * Like a hit, this does not need the instance latch
  */
 bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
-    std::lock_guard<std::mutex> guard(latch_);
+    if (mapped_) {
+        Page *page = findMapped(page_id);
+        if (page == nullptr) {
+            return false;
+        }
+        int pinCount = page->pin_count_.load();
+        do {
+            if (pinCount <= 0) {
+                return false;
+            }
+        } while (!page->pin_count_.compare_exchange_weak(pinCount,
+                                                         pinCount - 1));
+        return true;
+    }
+    BufferPoolInstance &instance = GetInstance(page_id);
 
     Page *page = nullptr;
-    if (!page_table_->Find(page_id, page)) {
-        return false;
-    }
-    if (page->pin_count_ == 0) {
+    if (!instance.page_table_->Find(page_id, page) ||
+        page->page_id_ != page_id) {
         return false;
     }
-    page->pin_count_--;
-    if (page->pin_count_ == 0) {
-        replacer_->Insert(page);
-    }
+    // before the pin goes, whoever evicts the page next must see it dirty
     if (is_dirty) {
         page->is_dirty_ = true;
     }
-    return true;
+    return unpinFrame(instance, page);
 }
 
 /*
@@ -108,18 +260,149 @@ bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
  * NOTE: make sure page_id != INVALID_PAGE_ID
  */
 bool BufferPoolManager::FlushPage(page_id_t page_id) {
-    std::lock_guard<std::mutex> guard(latch_);
-
     assert(page_id != INVALID_PAGE_ID);
+    if (mapped_) {
+        return false;
+    }
+    BufferPoolInstance &instance = GetInstance(page_id);
+    std::unique_lock<std::mutex> lock(instance.latch_);
+
     Page *page = nullptr;
-    if (!page_table_->Find(page_id, page)) {
+    if (!instance.page_table_->Find(page_id, page)) {
         return false;
     }
-    if (page->is_dirty_) {
+    // keep the page pinned while it is written outside the latch
+    pinPage(instance, page, page_id);
+    // a change may have its recLSN set but not have unpinned the page dirty
+    bool isDirty = page->is_dirty_.exchange(false) ||
+                   page->rec_lsn_ != INVALID_LSN;
+    lock.unlock();
+
+    waitForIO(page);
+    if (isDirty) {
+        lsn_t lsn = page->GetLSN();
+        flushLog(lsn);
         disk_manager_->WritePage(page_id, page->GetData());
-        page->is_dirty_ = false;
+        num_foreground_writes_++;
+        clearRecLSN(page, lsn);
     }
+    UnpinPage(page_id, false);
     return true;
+}
+
+/*
+ * Flush every page dirty when the call starts. Pages are pinned lock free and
+ * written outside any latch, dirty victims still being written back by other
+ * threads are waited for, so that everything is on disk after the sync
+ */
+void BufferPoolManager::FlushAllPages() {
+    if (mapped_) {
+        return;
+    }
+    std::vector<std::pair<page_id_t, Page *>> dirtyPages;
+    for (size_t i = 0; i < num_instances_; i++) {
+        BufferPoolInstance &instance = instances_[i];
+        for (size_t j = 0; j < instance.pool_size_; j++) {
+            Page *page = &instance.pages_[j];
+            page_id_t pageId = page->page_id_;
+            if (pageId == INVALID_PAGE_ID ||
+                (!page->is_dirty_ && page->rec_lsn_ == INVALID_LSN) ||
+                !pinPage(instance, page, pageId)) {
+                continue;
+            }
+            waitForIO(page);
+            if (page->is_dirty_.exchange(false) ||
+                page->rec_lsn_ != INVALID_LSN) {
+                dirtyPages.emplace_back(pageId, page);
+            } else {
+                unpinFrame(instance, page);
+            }
+        }
+        std::vector<Page *> writingBack;
+        {
+            std::lock_guard<std::mutex> guard(instance.writing_back_latch_);
+            for (auto &entry : instance.writing_back_) {
+                writingBack.push_back(entry.second);
+            }
+        }
+        for (Page *page : writingBack) {
+            waitForIO(page);
+        }
+    }
+
+    std::sort(dirtyPages.begin(), dirtyPages.end());
+    std::vector<lsn_t> writtenLSNs;
+    lsn_t maxLSN = INVALID_LSN;
+    for (auto &entry : dirtyPages) {
+        writtenLSNs.push_back(entry.second->GetLSN());
+        maxLSN = std::max(maxLSN, writtenLSNs.back());
+    }
+    flushLog(maxLSN);
+    std::vector<const char *> run;
+    for (size_t i = 0; i < dirtyPages.size(); i++) {
+        run.push_back(dirtyPages[i].second->GetData());
+        if (i + 1 == dirtyPages.size() ||
+            dirtyPages[i + 1].first != dirtyPages[i].first + 1) {
+            page_id_t firstPageId =
+                dirtyPages[i].first - static_cast<page_id_t>(run.size()) + 1;
+            disk_manager_->WritePages(firstPageId, run);
+            run.clear();
+        }
+    }
+    disk_manager_->SyncDB();
+    num_foreground_writes_ += dirtyPages.size();
+
+    for (size_t i = 0; i < dirtyPages.size(); i++) {
+        clearRecLSN(dirtyPages[i].second, writtenLSNs[i]);
+        unpinFrame(GetInstance(dirtyPages[i].first), dirtyPages[i].second);
+    }
+}
+
+/*
+ * Fuzzy checkpoint: collect the recLSN of every page with changes that may
+ * not be on disk, pages in the pool as well as evicted ones still being
+ * written back. A pinned page may be in the middle of a change logged
+ * before the call, its latch is waited for, so that such a change is
+ * either in the table or was written. Nothing else is stopped
+ */
+void BufferPoolManager::GetDirtyPageTable(
+    std::unordered_map<page_id_t, lsn_t> &dirty_pages) {
+    dirty_pages.clear();
+    if (mapped_) {
+        return;
+    }
+    auto addPage = [&dirty_pages](page_id_t pageId, lsn_t recLSN) {
+        if (recLSN == INVALID_LSN) {
+            return;
+        }
+        auto entry = dirty_pages.emplace(pageId, recLSN);
+        if (!entry.second) {
+            entry.first->second = std::min(entry.first->second, recLSN);
+        }
+    };
+    for (size_t i = 0; i < num_instances_; i++) {
+        BufferPoolInstance &instance = instances_[i];
+        for (size_t j = 0; j < instance.pool_size_; j++) {
+            Page *page = &instance.pages_[j];
+            page_id_t pageId = page->page_id_;
+            if (pageId == INVALID_PAGE_ID) {
+                continue;
+            }
+            // an unpinned page has no change in progress
+            if (page->pin_count_ > 0 && pinPage(instance, page, pageId)) {
+                page->RLatch();
+                addPage(pageId, page->rec_lsn_);
+                page->RUnlatch();
+                unpinFrame(instance, page);
+            } else {
+                addPage(pageId, page->rec_lsn_);
+            }
+        }
+        std::lock_guard<std::mutex> guard(instance.writing_back_latch_);
+        for (auto &entry : instance.writing_back_) {
+            addPage(entry.first, entry.second->rec_lsn_);
+        }
+    }
 }
 
 /**
@@ -131,22 +414,33 @@ bool BufferPoolManager::FlushPage(page_id_t page_id) {
  * the page is found within page table, but pin_count != 0, return false
  */
 bool BufferPoolManager::DeletePage(page_id_t page_id) {
-    std::lock_guard<std::mutex> guard(latch_);
+    if (mapped_) {
+        return false;
+    }
+    BufferPoolInstance &instance = GetInstance(page_id);
+    std::unique_lock<std::mutex> lock(instance.latch_);
+    // do not let an in flight write back land after the page is deallocated
+    Page *victim;
+    while ((victim = findWritingBack(instance, page_id)) != nullptr) {
+        lock.unlock();
+        waitForIO(victim);
+        lock.lock();
+    }
     Page *page = nullptr;
-    if (page_table_->Find(page_id, page)) {
-        if (page->GetPinCount() != 0) {
+    if (instance.page_table_->Find(page_id, page)) {
+        if (!claimFrame(page)) {
             // some User is using this page, can not delete
             return false;
         }
         // reset Page
         page->page_id_ = INVALID_PAGE_ID;
-        page->pin_count_ = 0;
         page->is_dirty_ = false;
         page->ResetMemory();
 
-        replacer_->Erase(page);
-        page_table_->Remove(page_id);
-        free_list_->push_back(page);
+        instance.replacer_->Remove(page);
+        instance.page_table_->Remove(page_id);
+        instance.free_list_->push_back(page);
+        page->pin_count_ = 0;
     }
 
     disk_manager_->DeallocatePage(page_id);
@@ -161,71 +455,617 @@ bool BufferPoolManager::DeletePage(page_id_t page_id) {
  * update new page's metadata, zero out memory and add corresponding entry
  * into page table. return nullptr if all the pages in pool are pinned
  */
-Page *BufferPoolManager::NewPage(page_id_t &page_id) {
-    std::lock_guard<std::mutex> guard(latch_);
+Page *BufferPoolManager::NewPage(page_id_t &page_id, Extent *extent) {
+    if (mapped_) {
+        return nullptr;
+    }
+    BufferPoolInstance *instance = &instances_[0];
+    page_id_t newPageId = INVALID_PAGE_ID;
+    if (num_instances_ > 1) {
+        // the page id decides which instance owns the page, so it has to be
+        // allocated before a frame can be chosen
+        newPageId = allocatePage(extent);
+        instance = &GetInstance(newPageId);
+    }
+    std::unique_lock<std::mutex> lock(instance->latch_);
 
-    Page *newPage = nullptr;
-    newPage = findUnusedPage();
+    page_id_t victimPageId;
+    Page *newPage = findUnusedPage(*instance, victimPageId);
 
     if (newPage == nullptr) {
+        if (newPageId != INVALID_PAGE_ID) {
+            disk_manager_->DeallocatePage(newPageId);
+        }
         return newPage;
     }
 
-    // now newPage is clear
-    page_id = disk_manager_->AllocatePage();
+    if (newPageId == INVALID_PAGE_ID) {
+        newPageId = allocatePage(extent);
+    }
+    page_id = newPageId;
     newPage->page_id_ = page_id;
     newPage->is_dirty_ = true;
+    newPage->io_pending_ = true;
+    newPage->io_latch_.lock();
     newPage->pin_count_ = 1;
 
-    page_table_->Insert(newPage->page_id_, newPage);
+    instance->page_table_->Insert(newPage->page_id_, newPage);
+    instance->replacer_->RecordAccess(newPage);
 
+    lock.unlock();
+    // write back the victim and clear the frame
+    finishIO(*instance, newPage, victimPageId, false);
     return newPage;
 }
 
 /**
  * find unused page from free list first than replacer, return null if not enough memory
+ * (with a strategy, a frame of its ring is tried before both)
+ * caller must hold instance.latch_
+ * The frame is returned with pin count -1, the caller publishes it by setting
+ * the pin count once page_id_ is set.
+ * If the victim is dirty its content stays in the frame and victim_page_id is
+ * set, the caller has to hand it to finishIO() to be written back
  */
-Page *BufferPoolManager::findUnusedPage() {
-    Page *page;
-    if (!free_list_->empty()) {
+Page *BufferPoolManager::findUnusedPage(BufferPoolInstance &instance,
+                                        page_id_t &victim_page_id,
+                                        BufferAccessStrategy *strategy) {
+    victim_page_id = INVALID_PAGE_ID;
+    Page *page = nullptr;
+    if (strategy != nullptr) {
+        page = findRingPage(instance, *strategy);
+    }
+    if (page == nullptr && !instance.free_list_->empty()) {
         // fetch Page from free list first
-        page = free_list_->front();
-        free_list_->pop_front();
+        page = instance.free_list_->front();
+        instance.free_list_->pop_front();
 
+        // a reader that looked this frame up for the page it held before may
+        // still have it pinned for a moment
+        while (!claimFrame(page)) {
+            std::this_thread::yield();
+        }
         assert(page->page_id_ == INVALID_PAGE_ID);
-        assert(page->pin_count_ == 0);
         assert(!page->is_dirty_);
-    } else {
-        // fetch Page from replacer
-        if (!replacer_->Victim(page)) {
+        if (cleaner_running_ &&
+            instance.free_list_->size() < cleaner_free_frames_) {
+            cleaner_cv_.notify_one();
+        }
+        return page;
+    }
+    // otherwise fetch Page from replacer
+    if (page == nullptr && (page = claimVictim(instance)) == nullptr) {
+        return nullptr;
+    }
+    evictPage(instance, page, victim_page_id);
+    return page;
+}
+
+/*
+ * Take the next replacement candidate that still holds a page and claim it.
+ * Skip frames pinned since they were unpinned (they come back with their
+ * access history once unpinned again) and free frames. The caller evicts
+ * the page or gives the frame back to the replacer, the history goes with
+ * evictPage() only. caller must hold instance.latch_
+ */
+Page *BufferPoolManager::claimVictim(BufferPoolInstance &instance) {
+    Page *page = nullptr;
+    while (page == nullptr) {
+        if (!instance.replacer_->Victim(page)) {
             return nullptr;
         }
+        if (!claimFrame(page)) {
+            page = nullptr;
+        } else if (page->page_id_ == INVALID_PAGE_ID) {
+            page->pin_count_ = 0;
+            page = nullptr;
+        }
+    }
+    return page;
+}
+
+/*
+ * Drop the page of a claimed frame from the page table, and its access
+ * history from the replacer. If it is dirty, its content stays in the frame
+ * until written back and victim_page_id is set. caller must hold
+ * instance.latch_
+ */
+void BufferPoolManager::evictPage(BufferPoolInstance &instance, Page *page,
+                                  page_id_t &victim_page_id) {
+    victim_page_id = INVALID_PAGE_ID;
+    instance.replacer_->Remove(page);
+    instance.page_table_->Remove(page->page_id_);
+    if (page->is_dirty_.exchange(false)) {
+        victim_page_id = page->page_id_;
+        std::lock_guard<std::mutex> guard(instance.writing_back_latch_);
+        instance.writing_back_[victim_page_id] = page;
+    }
+    page->page_id_ = INVALID_PAGE_ID;
+}
+
+/*
+ * Search the ring for a frame of this instance that still holds the page the
+ * scan put there and is unpinned. Claim it, take it out of the replacer and
+ * make its slot current. Otherwise advance the ring so that the frame chosen
+ * instead replaces the next slot
+ */
+Page *BufferPoolManager::findRingPage(BufferPoolInstance &instance,
+                                      BufferAccessStrategy &strategy) {
+    size_t ringSize = strategy.ring_.size();
+    for (size_t i = 1; i <= ringSize; i++) {
+        size_t slot = (strategy.current_ + i) % ringSize;
+        Page *page = strategy.ring_[slot];
+        if (page == nullptr || page < instance.pages_ ||
+            page >= instance.pages_ + instance.pool_size_) {
+            continue;
+        }
+        if (page->page_id_ != strategy.ring_page_ids_[slot] ||
+            !claimFrame(page)) {
+            continue;
+        }
+        instance.replacer_->Remove(page);
+        strategy.current_ = slot;
+        return page;
+    }
+    strategy.current_ = (strategy.current_ + 1) % ringSize;
+    return nullptr;
+}
 
-        // write page back to disk
-        assert(page->pin_count_ == 0);
-        page_table_->Remove(page->page_id_);
-        if (page->is_dirty_) {
-            disk_manager_->WritePage(page->page_id_, page->GetData());
-            page->is_dirty_ = false;
+/*
+ * Pin page if the frame still holds page_id, without the instance latch.
+ * A frame that is changing pages has pin count -1 and can not be pinned, and a
+ * pinned frame keeps its page, so checking page_id_ after pinning is enough
+ */
+bool BufferPoolManager::pinPage(BufferPoolInstance &instance, Page *page,
+                                page_id_t page_id) {
+    int pinCount = page->pin_count_.load();
+    do {
+        if (pinCount < 0) {
+            return false;
         }
-        page->ResetMemory();
+    } while (!page->pin_count_.compare_exchange_weak(pinCount, pinCount + 1));
+
+    if (page->page_id_ != page_id) {
+        // the frame moved on to another page after it was looked up
+        unpinFrame(instance, page);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Drop one pin. A frame holding a page becomes a replacement candidate when
+ * its last pin goes. return false if it was not pinned
+ */
+bool BufferPoolManager::unpinFrame(BufferPoolInstance &instance, Page *page) {
+    // only stable while we still hold the pin
+    bool holdsPage = page->page_id_ != INVALID_PAGE_ID;
+    int pinCount = page->pin_count_.load();
+    do {
+        if (pinCount <= 0) {
+            return false;
+        }
+    } while (!page->pin_count_.compare_exchange_weak(pinCount, pinCount - 1));
+
+    if (pinCount == 1 && holdsPage) {
+        instance.replacer_->Insert(page);
+    }
+    return true;
+}
+
+/*
+ * take an unpinned frame away from its page: its pin count goes from 0 to -1
+ * so that nobody can pin it any more. caller must hold instance.latch_
+ */
+bool BufferPoolManager::claimFrame(Page *page) {
+    int unpinned = 0;
+    return page->pin_count_.compare_exchange_strong(unpinned, -1);
+}
+
+/*
+ * Second half of FetchPage()/NewPage(), called without the instance latch
+ * while holding page->io_latch_: write the victim back if it was dirty, then
+ * read the page (or just zero the frame for a new page) and wake up waiters.
+ * A page that can not be read, or fails its checksum, leaves the page table
+ * before the waiters wake up, and the frame is marked for checkRead()
+ */
+void BufferPoolManager::finishIO(BufferPoolInstance &instance, Page *page,
+                                 page_id_t victim_page_id, bool read_page) {
+    if (victim_page_id != INVALID_PAGE_ID) {
+        writeBack(instance, page, victim_page_id);
+        num_foreground_writes_++;
+    }
+    page->ResetMemory();
+    if (read_page &&
+        !disk_manager_->ReadPage(page->page_id_, page->GetData())) {
+        std::lock_guard<std::mutex> guard(instance.latch_);
+        instance.page_table_->Remove(page->page_id_);
+        page->io_error_ = true;
+    }
+    page->io_pending_ = false;
+    page->io_latch_.unlock();
+}
+
+/*
+ * Called by FetchPage() with the page pinned, once its read is done. Throws
+ * if the read failed
+ */
+Page *BufferPoolManager::checkRead(BufferPoolInstance &instance, Page *page,
+                                   page_id_t page_id) {
+    if (dropFailedRead(instance, page)) {
+        throw Exception(EXCEPTION_TYPE_IO,
+                        "can not read page " + std::to_string(page_id));
+    }
+    return page;
+}
+
+/*
+ * If the read of the pinned page failed, give the pin back and return true.
+ * The last pin to go frees the frame. The page table does not lead to the
+ * frame any more, but a lock free lookup may have pinned it just before, so
+ * who is last is decided under the instance latch
+ */
+bool BufferPoolManager::dropFailedRead(BufferPoolInstance &instance,
+                                       Page *page) {
+    if (!page->io_error_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(instance.latch_);
+    int lastPin = 1;
+    if (page->pin_count_.compare_exchange_strong(lastPin, -1)) {
+        instance.replacer_->Remove(page);
         page->page_id_ = INVALID_PAGE_ID;
+        page->io_error_ = false;
+        page->ResetMemory();
+        instance.free_list_->push_back(page);
+        page->pin_count_ = 0;
+    } else {
+        page->pin_count_--;
+    }
+    return true;
+}
+
+/*
+ * write the evicted copy of victim_page_id held by page, and let FetchPage()
+ * read it from disk again
+ */
+void BufferPoolManager::writeBack(BufferPoolInstance &instance, Page *page,
+                                  page_id_t victim_page_id) {
+    flushLog(page->GetLSN());
+    disk_manager_->WritePage(victim_page_id, page->GetData());
+    std::lock_guard<std::mutex> guard(instance.writing_back_latch_);
+    instance.writing_back_.erase(victim_page_id);
+}
+
+/*
+ * page was written holding its changes up to lsn. Unless it changed since,
+ * it is clean until its next change sets its recLSN again. The latch keeps
+ * a change from being half done while the LSN is compared
+ */
+void BufferPoolManager::clearRecLSN(Page *page, lsn_t lsn) {
+    if (page->rec_lsn_ == INVALID_LSN) {
+        return;
+    }
+    page->RLatch();
+    if (page->GetLSN() == lsn) {
+        page->rec_lsn_ = INVALID_LSN;
+    }
+    page->RUnlatch();
+}
+
+/*
+ * WAL: a page may only be written once the log is on disk up to its last
+ * change. Forces the log manager to flush if it is not. Not only while
+ * logging is on, recovery logs what it undoes with logging still off
+ */
+void BufferPoolManager::flushLog(lsn_t lsn) {
+    if (log_manager_ != nullptr && lsn > log_manager_->GetPersistentLSN()) {
+        log_manager_->Flush(lsn);
+    }
+}
+
+/*
+ * return the frame still writing back an evicted copy of page_id, or nullptr
+ */
+Page *BufferPoolManager::findWritingBack(BufferPoolInstance &instance,
+                                         page_id_t page_id) {
+    std::lock_guard<std::mutex> guard(instance.writing_back_latch_);
+    auto writing = instance.writing_back_.find(page_id);
+    return writing == instance.writing_back_.end() ? nullptr : writing->second;
+}
+
+/*
+ * id for a new page, from the extent of its object if it has one
+ */
+page_id_t BufferPoolManager::allocatePage(Extent *extent) {
+    return extent != nullptr ? extent->AllocatePage(disk_manager_)
+                             : disk_manager_->AllocatePage();
+}
+
+/*
+ * block until the read/write back running on this frame is done
+ */
+void BufferPoolManager::waitForIO(Page *page) {
+    if (page->io_pending_) {
+        std::lock_guard<std::mutex> guard(page->io_latch_);
+    }
+}
+
+/*
+ * FetchPage() of a read only pool: pin the view of the page, made with the
+ * rest of its chunk if it is the first page of the chunk fetched. Lock free,
+ * a view never changes pages. Returns nullptr past the end of the db file,
+ * throws like a failed read if the page fails its checksum
+ */
+Page *BufferPoolManager::fetchMapped(page_id_t page_id) {
+    if (page_id < 0 || static_cast<size_t>(page_id) >= num_mapped_pages_) {
+        return nullptr;
+    }
+    size_t chunkIndex = page_id / MAPPED_CHUNK_PAGES;
+    MappedChunk *chunk = mapped_chunks_[chunkIndex];
+    if (chunk == nullptr) {
+        chunk = makeMappedChunk(chunkIndex);
+    }
+    size_t index = page_id % MAPPED_CHUNK_PAGES;
+    Page *page = &chunk->pages_[index];
+    uint8_t checked = chunk->checked_[index];
+    if (checked == 0) {
+        // racing threads verify the page twice, and agree
+        checked = disk_manager_->VerifyPage(page_id, page->GetData()) ? 1 : 2;
+        chunk->checked_[index] = checked;
     }
+    if (checked == 2) {
+        throw Exception(EXCEPTION_TYPE_IO,
+                        "can not read page " + std::to_string(page_id));
+    }
+    page->pin_count_++;
     return page;
 }
 
+/*
+ * the view of a fetched page of a read only pool, nullptr if there is none
+ */
+Page *BufferPoolManager::findMapped(page_id_t page_id) {
+    if (page_id < 0 || static_cast<size_t>(page_id) >= num_mapped_pages_) {
+        return nullptr;
+    }
+    MappedChunk *chunk = mapped_chunks_[page_id / MAPPED_CHUNK_PAGES];
+    return chunk == nullptr ? nullptr
+                            : &chunk->pages_[page_id % MAPPED_CHUNK_PAGES];
+}
+
+/*
+ * Publish views of the pages of a chunk. Of threads making the same chunk at
+ * the same time, the first to publish wins and the others use its views
+ */
+BufferPoolManager::MappedChunk *
+BufferPoolManager::makeMappedChunk(size_t chunk_index) {
+    MappedChunk *chunk = new MappedChunk;
+    page_id_t firstPageId = chunk_index * MAPPED_CHUNK_PAGES;
+    for (size_t i = 0; i < MAPPED_CHUNK_PAGES; i++) {
+        Page &page = chunk->pages_[i];
+        page.page_id_ = firstPageId + i;
+        page.data_ = disk_manager_->GetMappedPage(firstPageId + i);
+        page.page_size_ = disk_manager_->GetPageSize();
+        chunk->checked_[i] = 0;
+    }
+    MappedChunk *published = nullptr;
+    if (!mapped_chunks_[chunk_index].compare_exchange_strong(published,
+                                                             chunk)) {
+        delete chunk;
+        return published;
+    }
+    return chunk;
+}
+
+/*
+ * Queue page ids for the prefetch thread. The queue holds at most pool_size_
+ * ids, more could not stay in the pool until they are fetched anyway
+ */
+void BufferPoolManager::Prefetch(page_id_t page_id) {
+    PrefetchRange(page_id, 1);
+}
+
+void BufferPoolManager::PrefetchRange(page_id_t page_id, int count) {
+    if (mapped_) {
+        disk_manager_->AdviseMappedPages(page_id, count);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(prefetch_latch_);
+        if (prefetch_thread_ == nullptr) {
+            prefetch_running_ = true;
+            prefetch_thread_ =
+                new std::thread(&BufferPoolManager::runPrefetcher, this);
+        }
+        for (int i = 0; i < count && prefetch_queue_.size() < pool_size_;
+             i++) {
+            prefetch_queue_.push_back(page_id + i);
+        }
+    }
+    prefetch_cv_.notify_one();
+}
+
+void BufferPoolManager::runPrefetcher() {
+    std::unique_lock<std::mutex> lock(prefetch_latch_);
+    while (true) {
+        prefetch_cv_.wait(lock, [this] {
+            return !prefetch_running_ || !prefetch_queue_.empty();
+        });
+        if (!prefetch_running_) {
+            return;
+        }
+        page_id_t pageId = prefetch_queue_.front();
+        prefetch_queue_.pop_front();
+        lock.unlock();
+        prefetchPage(pageId);
+        lock.lock();
+    }
+}
+
+/*
+ * Read page_id into a frame the way a miss does, but leave it unpinned. It is
+ * not recorded as an access, the replacer sees it once it is fetched
+ */
+void BufferPoolManager::prefetchPage(page_id_t page_id) {
+    if (page_id < 0 || page_id >= disk_manager_->GetNextPageId()) {
+        return;
+    }
+    BufferPoolInstance &instance = GetInstance(page_id);
+    std::unique_lock<std::mutex> lock(instance.latch_);
+    Page *page = nullptr;
+    if (instance.page_table_->Find(page_id, page) ||
+        findWritingBack(instance, page_id) != nullptr) {
+        return;
+    }
+    page_id_t victimPageId;
+    page = findUnusedPage(instance, victimPageId);
+    if (page == nullptr) {
+        return;
+    }
+    page->page_id_ = page_id;
+    page->io_pending_ = true;
+    page->io_latch_.lock();
+    // pinned while the read is in flight, like for any other miss
+    page->pin_count_ = 1;
+    instance.page_table_->Insert(page_id, page);
+    num_prefetches_++;
+    lock.unlock();
+
+    if (victimPageId != INVALID_PAGE_ID) {
+        writeBack(instance, page, victimPageId);
+        num_background_writes_++;
+    }
+    finishIO(instance, page, INVALID_PAGE_ID, true);
+    if (!dropFailedRead(instance, page)) {
+        unpinFrame(instance, page);
+    }
+}
+
+/*
+ * Start the cleaner thread. Every CLEANER_TIMEOUT, or when a miss takes a
+ * free frame below the target, it refills the free list of every instance
+ */
+void BufferPoolManager::RunCleanerThread(size_t num_free_frames) {
+    if (cleaner_running_ || mapped_) {
+        return;
+    }
+    cleaner_free_frames_ =
+        std::max<size_t>(1, (num_free_frames + num_instances_ - 1) /
+                                num_instances_);
+    cleaner_running_ = true;
+    cleaner_thread_ = new std::thread(&BufferPoolManager::runCleaner, this);
+}
+
+/*
+ * Stop and join the cleaner thread
+ */
+void BufferPoolManager::StopCleanerThread() {
+    if (cleaner_thread_ == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(cleaner_latch_);
+        cleaner_running_ = false;
+    }
+    cleaner_cv_.notify_one();
+    cleaner_thread_->join();
+    delete cleaner_thread_;
+    cleaner_thread_ = nullptr;
+}
+
+void BufferPoolManager::runCleaner() {
+    std::unique_lock<std::mutex> lock(cleaner_latch_);
+    while (cleaner_running_) {
+        lock.unlock();
+        for (size_t i = 0; i < num_instances_; i++) {
+            cleanInstance(instances_[i]);
+        }
+        lock.lock();
+        cleaner_cv_.wait_for(lock, CLEANER_TIMEOUT);
+    }
+}
+
+/*
+ * Evict replacement candidates until the free list holds cleaner_free_frames_
+ * frames, writing dirty ones back outside the instance latch. A page whose
+ * last change is not in the persistent log yet can not be written (WAL), it
+ * goes back to the replacer and is left to a later round
+ */
+void BufferPoolManager::cleanInstance(BufferPoolInstance &instance) {
+    std::unique_lock<std::mutex> lock(instance.latch_);
+    size_t candidates = instance.pool_size_;
+    while (instance.free_list_->size() < cleaner_free_frames_ &&
+           candidates-- > 0) {
+        Page *page = claimVictim(instance);
+        if (page == nullptr) {
+            return;
+        }
+        if (page->is_dirty_ && ENABLE_LOGGING && log_manager_ != nullptr &&
+            page->GetLSN() > log_manager_->GetPersistentLSN()) {
+            page->pin_count_ = 0;
+            instance.replacer_->Insert(page);
+            continue;
+        }
+        page_id_t victimPageId;
+        evictPage(instance, page, victimPageId);
+        if (victimPageId != INVALID_PAGE_ID) {
+            // FetchPage() of the victim waits for the write like for any other
+            // evicted page
+            page->io_pending_ = true;
+            page->io_latch_.lock();
+            lock.unlock();
+            writeBack(instance, page, victimPageId);
+            num_background_writes_++;
+            page->io_pending_ = false;
+            page->io_latch_.unlock();
+            lock.lock();
+        }
+        page->ResetMemory();
+        instance.free_list_->push_back(page);
+        page->pin_count_ = 0;
+    }
+}
+
 /**
  * only for test
  */
 int BufferPoolManager::GetPagePinCount(const page_id_t &page_id) {
+    if (mapped_) {
+        Page *page = findMapped(page_id);
+        return page == nullptr ? 0 : page->GetPinCount();
+    }
     Page *page = nullptr;
-    if (!page_table_->Find(page_id, page)) {
+    if (!GetInstance(page_id).page_table_->Find(page_id, page)) {
         return 0;
     }
     return page->GetPinCount();
 }
 
+size_t BufferPoolManager::GetNumHits() {
+    size_t numHits = 0;
+    for (size_t i = 0; i < num_instances_; i++) {
+        numHits += instances_[i].num_hits_;
+    }
+    return numHits;
+}
+
+size_t BufferPoolManager::GetNumMisses() {
+    size_t numMisses = 0;
+    for (size_t i = 0; i < num_instances_; i++) {
+        numMisses += instances_[i].num_misses_;
+    }
+    return numMisses;
+}
+
 bool BufferPoolManager::AllPageUnpined() {
+    for (size_t i = 0; i * MAPPED_CHUNK_PAGES < num_mapped_pages_; i++) {
+        MappedChunk *chunk = mapped_chunks_[i];
+        for (size_t j = 0; chunk != nullptr && j < MAPPED_CHUNK_PAGES; j++) {
+            if (chunk->pages_[j].pin_count_ != 0)
+                return false;
+        }
+    }
     for (size_t i = 1; i < pool_size_; i++) {
         if (pages_[i].pin_count_ != 0)
             return false;
@@ -236,11 +1076,19 @@ bool BufferPoolManager::AllPageUnpined() {
 
 std::string BufferPoolManager::ToString() const {
     std::ostringstream stream;
-    stream << "free list size=" << free_list_->size() << ", " << "lru replacer size="
-        << replacer_->Size() << ". ";
+    size_t freeListSize = 0, replacerSize = 0;
+    for (size_t i = 0; i < num_instances_; i++) {
+        freeListSize += instances_[i].free_list_->size();
+        replacerSize += instances_[i].replacer_->Size();
+    }
+    if (mapped_) {
+        stream << "read only, " << num_mapped_pages_ << " mapped pages. ";
+    }
+    stream << "free list size=" << freeListSize << ", " << "lru replacer size="
+        << replacerSize << ". ";
     for (size_t i = 0; i < pool_size_; i++) {
-        stream << "page[" << i << "]:(page_id=" << pages_[i].page_id_ << ", pin count="
-            << pages_[i].pin_count_ << ") ";
+        stream << "page[" << i << "]:(page_id=" << pages_[i].page_id_.load()
+            << ", pin count=" << pages_[i].pin_count_.load() << ") ";
     }
     return stream.str();
 }
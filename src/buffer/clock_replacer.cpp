@@ -0,0 +1,84 @@
+/**
+ * CLOCK implementation
+ */
+#include <cassert>
+
+#include "buffer/clock_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+ClockReplacer<T>::ClockReplacer(size_t num_frames, const T &base)
+    : num_frames_(num_frames), base_(base), in_replacer_(num_frames, 0),
+      ref_bit_(num_frames, 0) {}
+
+template <typename T> ClockReplacer<T>::~ClockReplacer() {}
+
+/*
+ * Make value evictable and set its reference bit
+ */
+template <typename T> void ClockReplacer<T>::Insert(const T &value) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    size_t frame = frameOf(value);
+    assert(frame < num_frames_);
+    if (!in_replacer_[frame]) {
+        in_replacer_[frame] = 1;
+        size_++;
+    }
+    ref_bit_[frame] = 1;
+}
+
+/* Sweep the clock hand, clearing reference bits, until an evictable frame
+ * with a clear bit is found. Return false if nothing is evictable
+ */
+template <typename T> bool ClockReplacer<T>::Victim(T &value) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    if (size_ == 0) {
+        return false;
+    }
+    // at most two rounds: the first one may only clear reference bits
+    while (true) {
+        size_t frame = hand_;
+        hand_ = (hand_ + 1) % num_frames_;
+        if (!in_replacer_[frame]) {
+            continue;
+        }
+        if (ref_bit_[frame]) {
+            ref_bit_[frame] = 0;
+            continue;
+        }
+        in_replacer_[frame] = 0;
+        size_--;
+        value = base_ + frame;
+        return true;
+    }
+}
+
+/*
+ * Remove value from the replacer. If removal is successful, return true,
+ * otherwise return false
+ */
+template <typename T> bool ClockReplacer<T>::Erase(const T &value) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    size_t frame = frameOf(value);
+    assert(frame < num_frames_);
+    if (!in_replacer_[frame]) {
+        return false;
+    }
+    in_replacer_[frame] = 0;
+    ref_bit_[frame] = 0;
+    size_--;
+    return true;
+}
+
+template <typename T> size_t ClockReplacer<T>::Size() { return size_; }
+
+template class ClockReplacer<Page *>;
+// test only
+template class ClockReplacer<int>;
+
+} // namespace cmudb
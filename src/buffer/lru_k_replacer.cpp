@@ -0,0 +1,139 @@
+/**
+ * LRU-K implementation
+ */
+#include <cassert>
+#include <cstring>
+
+#include "buffer/lru_k_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+LRUKReplacer<T>::LRUKReplacer(size_t num_frames, size_t k, const T &base)
+    : num_frames_(num_frames), k_(k), base_(base), history_(num_frames * k, 0),
+      history_size_(num_frames, 0), evictable_(num_frames, 0) {
+    assert(k_ > 0);
+}
+
+template <typename T> LRUKReplacer<T>::~LRUKReplacer() {}
+
+/*
+ * Make value evictable. A frame that never had an access recorded counts as
+ * accessed now, so the replacer also works for callers that only Insert
+ */
+template <typename T> void LRUKReplacer<T>::Insert(const T &value) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    size_t frame = frameOf(value);
+    assert(frame < num_frames_);
+    if (history_size_[frame] == 0) {
+        recordAccess(frame);
+    }
+    if (!evictable_[frame]) {
+        evictable_[frame] = 1;
+        size_++;
+    }
+}
+
+/* Evict the frame with the largest backward K-distance. Its history is kept
+ * until Remove(): the caller may find the frame pinned again and leave it,
+ * it must not come back as a frame never accessed. Return false if nothing
+ * is evictable
+ */
+template <typename T> bool LRUKReplacer<T>::Victim(T &value) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    if (size_ == 0) {
+        return false;
+    }
+    size_t victim = num_frames_;
+    bool victimInfinite = false;
+    uint64_t victimTimestamp = 0;
+    for (size_t frame = 0; frame < num_frames_; frame++) {
+        if (!evictable_[frame]) {
+            continue;
+        }
+        uint64_t *history = &history_[frame * k_];
+        bool infinite = history_size_[frame] < k_;
+        // infinite distance: compare last access (plain LRU), otherwise the
+        // K-th most recent access which is the oldest one kept
+        uint64_t timestamp =
+            infinite ? history[history_size_[frame] - 1] : history[0];
+        if (victim == num_frames_ || (infinite && !victimInfinite) ||
+            (infinite == victimInfinite && timestamp < victimTimestamp)) {
+            victim = frame;
+            victimInfinite = infinite;
+            victimTimestamp = timestamp;
+        }
+    }
+    assert(victim != num_frames_);
+    evictable_[victim] = 0;
+    size_--;
+    value = base_ + victim;
+    return true;
+}
+
+/*
+ * Make value non evictable (it got pinned), its access history is kept.
+ * return true if it was evictable
+ */
+template <typename T> bool LRUKReplacer<T>::Erase(const T &value) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    size_t frame = frameOf(value);
+    assert(frame < num_frames_);
+    if (!evictable_[frame]) {
+        return false;
+    }
+    evictable_[frame] = 0;
+    size_--;
+    return true;
+}
+
+/*
+ * Like Erase(), but the frame is about to hold another page so its history is
+ * dropped as well
+ */
+template <typename T> bool LRUKReplacer<T>::Remove(const T &value) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    size_t frame = frameOf(value);
+    assert(frame < num_frames_);
+    history_size_[frame] = 0;
+    if (!evictable_[frame]) {
+        return false;
+    }
+    evictable_[frame] = 0;
+    size_--;
+    return true;
+}
+
+template <typename T> size_t LRUKReplacer<T>::Size() { return size_; }
+
+/*
+ * Append the current timestamp to the access history of value
+ */
+template <typename T> void LRUKReplacer<T>::RecordAccess(const T &value) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    size_t frame = frameOf(value);
+    assert(frame < num_frames_);
+    recordAccess(frame);
+}
+
+template <typename T> void LRUKReplacer<T>::recordAccess(size_t frame) {
+    uint64_t *history = &history_[frame * k_];
+    if (history_size_[frame] == k_) {
+        // drop the oldest access
+        memmove(history, history + 1, (k_ - 1) * sizeof(uint64_t));
+        history_size_[frame]--;
+    }
+    history[history_size_[frame]++] = ++current_timestamp_;
+}
+
+template class LRUKReplacer<Page *>;
+// test only
+template class LRUKReplacer<int>;
+
+} // namespace cmudb
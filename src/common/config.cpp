@@ -4,4 +4,8 @@ namespace cmudb {
   std::atomic<bool> ENABLE_LOGGING(false);  // for virtual table
   std::chrono::duration<long long int> LOG_TIMEOUT =
    std::chrono::seconds(1);
+  // how often the buffer pool cleaner looks for frames to free
+  std::chrono::milliseconds CLEANER_TIMEOUT = std::chrono::milliseconds(10);
+  // how often the checkpoint thread takes a checkpoint
+  std::chrono::milliseconds CHECKPOINT_INTERVAL = std::chrono::seconds(30);
 }
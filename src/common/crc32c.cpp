@@ -0,0 +1,147 @@
+/**
+ * crc32c.cpp
+ */
+#include <cstring>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+#include "common/crc32c.h"
+
+namespace cmudb {
+
+namespace {
+
+// reflected polynomial 0x1EDC6F41
+const uint32_t POLY = 0x82F63B78;
+
+#ifdef __SSE4_2__
+
+// the crc32 instruction has a latency of three cycles but can start one every
+// cycle, so data is checksummed as three interleaved streams of STREAM bytes,
+// which are combined by shifting the crc of one stream over the next
+const size_t STREAM = 256;
+
+uint32_t gf2MatrixTimes(const uint32_t *matrix, uint32_t vector) {
+  uint32_t sum = 0;
+  while (vector != 0) {
+    if (vector & 1) {
+      sum ^= *matrix;
+    }
+    vector >>= 1;
+    matrix++;
+  }
+  return sum;
+}
+
+void gf2MatrixSquare(uint32_t *square, const uint32_t *matrix) {
+  for (int n = 0; n < 32; n++) {
+    square[n] = gf2MatrixTimes(matrix, matrix[n]);
+  }
+}
+
+// the crc of a message followed by STREAM zero bytes, as a function of the
+// crc of the message, looked up a byte at a time
+struct ShiftTable {
+  uint32_t entries[4][256];
+  ShiftTable() {
+    // operator for one zero bit, squared until it is one for STREAM bytes
+    uint32_t odd[32], even[32];
+    odd[0] = POLY;
+    for (int n = 1; n < 32; n++) {
+      odd[n] = 1u << (n - 1);
+    }
+    gf2MatrixSquare(even, odd); // two zero bits
+    gf2MatrixSquare(odd, even); // four
+    gf2MatrixSquare(even, odd); // a zero byte
+    uint32_t *op = even;
+    for (size_t len = STREAM; len > 1; len >>= 1) {
+      gf2MatrixSquare(op == even ? odd : even, op);
+      op = op == even ? odd : even;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+      for (int byte = 0; byte < 4; byte++) {
+        entries[byte][n] = gf2MatrixTimes(op, n << (8 * byte));
+      }
+    }
+  }
+  inline uint32_t Shift(uint32_t crc) const {
+    return entries[0][crc & 0xff] ^ entries[1][(crc >> 8) & 0xff] ^
+           entries[2][(crc >> 16) & 0xff] ^ entries[3][crc >> 24];
+  }
+};
+const ShiftTable shift_table;
+
+inline uint64_t load64(const char *data) {
+  uint64_t word;
+  memcpy(&word, data, 8);
+  return word;
+}
+
+#else
+
+struct Crc32cTable {
+  uint32_t entries[256];
+  Crc32cTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (crc & 1 ? POLY : 0);
+      }
+      entries[i] = crc;
+    }
+  }
+};
+const Crc32cTable table;
+
+#endif
+
+} // namespace
+
+#ifdef __SSE4_2__
+
+uint32_t Crc32c(const char *data, size_t len, uint32_t crc) {
+  uint64_t crc0 = ~crc;
+  while (len >= 3 * STREAM) {
+    uint64_t crc1 = 0, crc2 = 0;
+    for (const char *end = data + STREAM; data < end; data += 8) {
+      crc0 = _mm_crc32_u64(crc0, load64(data));
+      crc1 = _mm_crc32_u64(crc1, load64(data + STREAM));
+      crc2 = _mm_crc32_u64(crc2, load64(data + 2 * STREAM));
+    }
+    crc0 = shift_table.Shift(static_cast<uint32_t>(crc0)) ^ crc1;
+    crc0 = shift_table.Shift(static_cast<uint32_t>(crc0)) ^ crc2;
+    data += 2 * STREAM;
+    len -= 3 * STREAM;
+  }
+  while (len >= 8) {
+    crc0 = _mm_crc32_u64(crc0, load64(data));
+    data += 8;
+    len -= 8;
+  }
+  uint32_t crc32 = static_cast<uint32_t>(crc0);
+  while (len-- > 0) {
+    crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(*data++));
+  }
+  return ~crc32;
+}
+
+bool Crc32cIsHardware() { return true; }
+
+#else
+
+uint32_t Crc32c(const char *data, size_t len, uint32_t crc) {
+  crc = ~crc;
+  while (len-- > 0) {
+    crc = table.entries[(crc ^ static_cast<uint8_t>(*data++)) & 0xff] ^
+          (crc >> 8);
+  }
+  return ~crc;
+}
+
+bool Crc32cIsHardware() { return false; }
+
+#endif
+
+} // namespace cmudb
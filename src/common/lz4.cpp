@@ -0,0 +1,191 @@
+/**
+ * lz4.cpp
+ *
+ * A block is a series of sequences: a token (literal length in the high four
+ * bits, match length - MIN_MATCH in the low four, 15 meaning more length
+ * bytes follow, each adding up to 255), the literals, and the two byte little
+ * endian offset of the match. The last sequence only has literals.
+ */
+#include <cstdint>
+#include <cstring>
+
+#include "common/lz4.h"
+
+namespace cmudb {
+
+namespace {
+
+const int MIN_MATCH = 4;
+// the format requires the last LAST_LITERALS bytes to be literals, and the
+// last match to start MF_LIMIT bytes before the end at the latest
+const int LAST_LITERALS = 5;
+const int MF_LIMIT = 12;
+const int MAX_OFFSET = 65535;
+const int HASH_LOG = 12;
+// misses in a row before the search starts skipping ahead faster, so that
+// data that does not compress costs little
+const int SKIP_STRENGTH = 6;
+
+inline uint32_t read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, 4);
+  return value;
+}
+
+inline uint32_t hash32(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// a length of 15 or more in the token continues in extra bytes
+inline uint8_t *writeLength(uint8_t *op, int length) {
+  for (; length >= 255; length -= 255) {
+    *op++ = 255;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+inline bool readLength(const uint8_t *&ip, const uint8_t *iend, int &length) {
+  uint8_t byte;
+  do {
+    if (ip >= iend) {
+      return false;
+    }
+    byte = *ip++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+} // namespace
+
+int LZ4Compress(const char *src, int src_size, char *dst, int dst_capacity) {
+  const uint8_t *base = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *ip = base;
+  const uint8_t *anchor = base;
+  const uint8_t *iend = base + src_size;
+  const uint8_t *mflimit = iend - MF_LIMIT;
+  const uint8_t *matchlimit = iend - LAST_LITERALS;
+  uint8_t *op = reinterpret_cast<uint8_t *>(dst);
+  uint8_t *oend = op + dst_capacity;
+
+  if (src_size > MF_LIMIT) {
+    // positions + 1 of earlier sequences by hash, 0 for none
+    int table[1 << HASH_LOG];
+    memset(table, 0, sizeof(table));
+    int misses = 0;
+    while (ip < mflimit) {
+      uint32_t sequence = read32(ip);
+      uint32_t hash = hash32(sequence);
+      int candidate = table[hash];
+      table[hash] = static_cast<int>(ip - base) + 1;
+      if (candidate == 0 || ip - base - (candidate - 1) > MAX_OFFSET ||
+          read32(base + candidate - 1) != sequence) {
+        ip += 1 + (misses++ >> SKIP_STRENGTH);
+        continue;
+      }
+      const uint8_t *match = base + candidate - 1;
+      misses = 0;
+      int match_length = MIN_MATCH;
+      while (ip + match_length < matchlimit &&
+             ip[match_length] == match[match_length]) {
+        match_length++;
+      }
+
+      int literal_length = static_cast<int>(ip - anchor);
+      // token, literals, offset and both lengths at their longest
+      if (oend - op < 1 + literal_length + literal_length / 255 + 1 + 2 +
+                          (match_length - MIN_MATCH) / 255 + 1) {
+        return 0;
+      }
+      uint8_t *token = op++;
+      if (literal_length >= 15) {
+        *token = 15 << 4;
+        op = writeLength(op, literal_length - 15);
+      } else {
+        *token = static_cast<uint8_t>(literal_length << 4);
+      }
+      memcpy(op, anchor, literal_length);
+      op += literal_length;
+      int offset = static_cast<int>(ip - match);
+      *op++ = static_cast<uint8_t>(offset);
+      *op++ = static_cast<uint8_t>(offset >> 8);
+      if (match_length - MIN_MATCH >= 15) {
+        *token |= 15;
+        op = writeLength(op, match_length - MIN_MATCH - 15);
+      } else {
+        *token |= static_cast<uint8_t>(match_length - MIN_MATCH);
+      }
+      ip += match_length;
+      anchor = ip;
+    }
+  }
+
+  // the rest goes out as literals
+  int literal_length = static_cast<int>(iend - anchor);
+  if (oend - op < 1 + literal_length + literal_length / 255 + 1) {
+    return 0;
+  }
+  if (literal_length >= 15) {
+    *op++ = 15 << 4;
+    op = writeLength(op, literal_length - 15);
+  } else {
+    *op++ = static_cast<uint8_t>(literal_length << 4);
+  }
+  memcpy(op, anchor, literal_length);
+  op += literal_length;
+  return static_cast<int>(op - reinterpret_cast<uint8_t *>(dst));
+}
+
+int LZ4Decompress(const char *src, int src_size, char *dst, int dst_capacity) {
+  const uint8_t *ip = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *iend = ip + src_size;
+  uint8_t *base = reinterpret_cast<uint8_t *>(dst);
+  uint8_t *op = base;
+  uint8_t *oend = base + dst_capacity;
+
+  while (ip < iend) {
+    uint8_t token = *ip++;
+    int literal_length = token >> 4;
+    if (literal_length == 15 && !readLength(ip, iend, literal_length)) {
+      return -1;
+    }
+    if (literal_length > iend - ip || literal_length > oend - op) {
+      return -1;
+    }
+    memcpy(op, ip, literal_length);
+    op += literal_length;
+    ip += literal_length;
+    if (ip == iend) {
+      // the last sequence has no match
+      break;
+    }
+
+    if (iend - ip < 2) {
+      return -1;
+    }
+    int offset = ip[0] | ip[1] << 8;
+    ip += 2;
+    int match_length = token & 15;
+    if (match_length == 15 && !readLength(ip, iend, match_length)) {
+      return -1;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > op - base || match_length > oend - op) {
+      return -1;
+    }
+    const uint8_t *match = op - offset;
+    if (offset >= match_length) {
+      memcpy(op, match, match_length);
+    } else {
+      // overlapping, repeats the last offset bytes
+      for (int i = 0; i < match_length; i++) {
+        op[i] = match[i];
+      }
+    }
+    op += match_length;
+  }
+  return static_cast<int>(op - base);
+}
+
+} // namespace cmudb
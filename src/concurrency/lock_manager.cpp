@@ -138,7 +138,7 @@ bool LockManager::Unlock(Transaction *txn, const RID &rid) {
     assert(txn->GetSharedLockSet()->count(rid) || txn->GetExclusiveLockSet()->count(rid));
 
     if (strict_2PL_) {
-        if (txn->GetState() != TransactionState::ABORTED ||
+        if (txn->GetState() != TransactionState::ABORTED &&
                 txn->GetState() != TransactionState::COMMITTED) {
             txn->SetState(TransactionState::ABORTED);
             return false;
@@ -161,7 +161,13 @@ bool LockManager::Unlock(Transaction *txn, const RID &rid) {
             break;
         }
     }
+    // nobody waits, a later request must not die for a transaction gone
+    if (lock_table_[rid].list.empty()) {
+        lock_table_.erase(rid);
+        return true;
+    }
     // oldest
+    lock_table_[rid].oldest = lock_table_[rid].list.front().txn_id;
     for (auto it = lock_table_[rid].list.begin();
             it != lock_table_[rid].list.end(); ++it) {
         if (it->txn_id < lock_table_[rid].oldest) {
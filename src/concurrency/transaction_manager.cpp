@@ -12,7 +12,9 @@ Transaction *TransactionManager::Begin() {
   Transaction *txn = new Transaction(next_txn_id_++);
 
   if (ENABLE_LOGGING) {
-    // TODO: write log and update transaction's prev_lsn here
+    LogRecord log_record(txn->GetTransactionId(), INVALID_LSN,
+                         LogRecordType::BEGIN);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(log_record));
   }
 
   return txn;
@@ -34,7 +36,13 @@ void TransactionManager::Commit(Transaction *txn) {
   write_set->clear();
 
   if (ENABLE_LOGGING) {
-    // TODO: write log and update transaction's prev_lsn here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::COMMIT);
+    lsn_t lsn = log_manager_->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    // the commit is durable once its record is, the flush thread writes it
+    // together with those of the transactions committing meanwhile
+    log_manager_->Flush(lsn);
   }
 
   // release all the lock
@@ -71,7 +79,9 @@ void TransactionManager::Abort(Transaction *txn) {
   write_set->clear();
 
   if (ENABLE_LOGGING) {
-    // TODO: write log and update transaction's prev_lsn here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(log_record));
   }
 
   // release all the lock
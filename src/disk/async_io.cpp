@@ -0,0 +1,325 @@
+/**
+ * async_io.cpp
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define HAVE_IO_URING
+#endif
+#endif
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "disk/async_io.h"
+
+namespace cmudb {
+
+ssize_t ReadFully(int fd, char *buf, size_t len, off_t offset) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pread(fd, buf + done, len - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return -errno;
+    }
+    if (n == 0) {
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
+ssize_t WriteFully(int fd, const char *buf, size_t len, off_t offset) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pwrite(fd, buf + done, len - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return n < 0 ? -errno : -EIO;
+    }
+    done += n;
+  }
+  return done;
+}
+
+AsyncIO *AsyncIO::Create(bool use_io_uring, size_t queue_depth) {
+  if (use_io_uring) {
+    try {
+      return new IOUring(queue_depth);
+    } catch (Exception &e) {
+      LOG_DEBUG("io_uring not available, using a thread pool");
+    }
+  }
+  return new ThreadPoolIO();
+}
+
+/*****************************************************************************
+ * THREAD POOL
+ *****************************************************************************/
+ThreadPoolIO::ThreadPoolIO(size_t num_threads) {
+  for (size_t i = 0; i < num_threads; i++) {
+    workers_.emplace_back(&ThreadPoolIO::runWorker, this);
+  }
+}
+
+/*
+ * Finish the queued requests, then stop the workers
+ */
+ThreadPoolIO::~ThreadPoolIO() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    running_ = false;
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPoolIO::Read(int fd, char *buf, size_t len, off_t offset,
+                        IOCallback callback) {
+  submit({false, fd, buf, len, offset, std::move(callback)});
+}
+
+void ThreadPoolIO::Write(int fd, const char *buf, size_t len, off_t offset,
+                         IOCallback callback) {
+  submit({true, fd, const_cast<char *>(buf), len, offset, std::move(callback)});
+}
+
+void ThreadPoolIO::submit(Request request) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    requests_.push_back(std::move(request));
+  }
+  cv_.notify_one();
+}
+
+void ThreadPoolIO::runWorker() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    cv_.wait(lock, [this] { return !running_ || !requests_.empty(); });
+    if (requests_.empty()) {
+      return;
+    }
+    Request request = std::move(requests_.front());
+    requests_.pop_front();
+    lock.unlock();
+
+    request.callback(
+        request.write
+            ? WriteFully(request.fd, request.buf, request.len, request.offset)
+            : ReadFully(request.fd, request.buf, request.len, request.offset));
+
+    lock.lock();
+  }
+}
+
+/*****************************************************************************
+ * IO_URING
+ *****************************************************************************/
+#ifdef HAVE_IO_URING
+
+/*
+ * Set up a ring of queue_depth entries and start the thread reaping its
+ * completions. No liburing, the rings are mapped and driven directly
+ */
+IOUring::IOUring(size_t queue_depth) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, queue_depth, &params);
+  if (ring_fd_ < 0) {
+    throw Exception(EXCEPTION_TYPE_NOT_IMPLEMENTED,
+                    std::string("io_uring_setup: ") + strerror(errno));
+  }
+  entries_ = params.sq_entries;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap
+                 ? sq_ring_
+                 : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+    int error = errno;
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (!single_mmap && cq_ring_ != MAP_FAILED) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    close(ring_fd_);
+    throw Exception(EXCEPTION_TYPE_NOT_IMPLEMENTED,
+                    std::string("io_uring mmap: ") + strerror(error));
+  }
+
+  char *sq = static_cast<char *>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+
+  reaper_ = new std::thread(&IOUring::runReaper, this);
+}
+
+/*
+ * Wait for the requests in flight, then stop the reaper with a no-op request
+ * that carries no Request
+ */
+IOUring::~IOUring() {
+  {
+    std::unique_lock<std::mutex> lock(submit_latch_);
+    submit_cv_.wait(lock, [this] { return in_flight_ == 0; });
+  }
+  submit(IORING_OP_NOP, -1, {nullptr, 0}, 0, nullptr);
+  reaper_->join();
+  delete reaper_;
+
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+}
+
+void IOUring::Read(int fd, char *buf, size_t len, off_t offset,
+                   IOCallback callback) {
+  submit(IORING_OP_READV, fd, {buf, len}, offset, std::move(callback));
+}
+
+void IOUring::Write(int fd, const char *buf, size_t len, off_t offset,
+                    IOCallback callback) {
+  submit(IORING_OP_WRITEV, fd, {const_cast<char *>(buf), len}, offset,
+         std::move(callback));
+}
+
+/*
+ * Queue one request and tell the kernel about it. Blocks while entries_
+ * requests are in flight
+ */
+void IOUring::submit(int opcode, int fd, struct iovec iov, off_t offset,
+                     IOCallback callback) {
+  std::unique_lock<std::mutex> lock(submit_latch_);
+  submit_cv_.wait(lock, [this] { return in_flight_ < entries_; });
+  in_flight_++;
+  // handed to the reaper through the kernel. It takes submit_latch_ before
+  // touching it, which also orders the accesses for tools that can not see
+  // into the kernel
+  Request *request = nullptr;
+  if (callback) {
+    request = new Request{iov, std::move(callback)};
+  }
+
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & *sq_mask_;
+  struct io_uring_sqe *sqe =
+      static_cast<struct io_uring_sqe *>(sqes_) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  if (request != nullptr) {
+    sqe->addr = reinterpret_cast<uint64_t>(&request->iov);
+    sqe->len = 1;
+  }
+  sqe->off = offset;
+  sqe->user_data = reinterpret_cast<uint64_t>(request);
+  sq_array_[index] = index;
+  // the entry has to be visible before the kernel sees the new tail
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+  while (syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0) < 0) {
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      LOG_DEBUG("io_uring_enter: %s", strerror(errno));
+      break;
+    }
+  }
+}
+
+/*
+ * Wait for completions and run their callbacks, until the no-op sent by the
+ * destructor comes back
+ */
+void IOUring::runReaper() {
+  bool running = true;
+  while (running) {
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      if (syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS,
+                  nullptr, 0) < 0 &&
+          errno != EINTR) {
+        LOG_DEBUG("io_uring_enter: %s", strerror(errno));
+      }
+      continue;
+    }
+    struct io_uring_cqe *cqe =
+        static_cast<struct io_uring_cqe *>(cqes_) + (head & *cq_mask_);
+    Request *request = reinterpret_cast<Request *>(cqe->user_data);
+    ssize_t result = cqe->res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+
+    {
+      std::lock_guard<std::mutex> guard(submit_latch_);
+      in_flight_--;
+    }
+    submit_cv_.notify_all();
+    if (request == nullptr) {
+      running = false;
+    } else {
+      request->callback(result);
+      delete request;
+    }
+  }
+}
+
+#else
+
+IOUring::IOUring(size_t queue_depth) {
+  throw Exception(EXCEPTION_TYPE_NOT_IMPLEMENTED, "io_uring not supported");
+}
+
+IOUring::~IOUring() {}
+
+void IOUring::Read(int fd, char *buf, size_t len, off_t offset,
+                   IOCallback callback) {}
+
+void IOUring::Write(int fd, const char *buf, size_t len, off_t offset,
+                    IOCallback callback) {}
+
+void IOUring::submit(int opcode, int fd, struct iovec iov, off_t offset,
+                     IOCallback callback) {}
+
+void IOUring::runReaper() {}
+
+#endif
+
+} // namespace cmudb
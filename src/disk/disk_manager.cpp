@@ -2,102 +2,825 @@
  * disk_manager.cpp
  */
 #include <assert.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
 #include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
 #include <iostream>
+#include <limits>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <thread>
+#include <unistd.h>
 
+#include "common/crc32c.h"
+#include "common/exception.h"
 #include "common/logger.h"
+#include "common/lz4.h"
 #include "disk/disk_manager.h"
+#include "page/header_page.h"
 
 namespace cmudb {
 
-static char *buffer_used = nullptr;
+// page map file: | magic (4) | page size (4) | sector size (4) | unused (4) |
+// followed by a PageLocation per page id
+static const uint32_t PAGE_MAP_MAGIC = 0x15445c0d;
+static const int PAGE_MAP_HEADER_SIZE = 16;
+
+// the directory part of a path, "." if it has none
+static std::string directoryOf(const std::string &path) {
+  std::string::size_type n = path.rfind('/');
+  return n == std::string::npos ? "." : path.substr(0, std::max<size_t>(n, 1));
+}
+
+// the files next to log_name whose names start with log_name + "."
+static std::vector<std::string> listLogFiles(const std::string &log_name) {
+  std::vector<std::string> names;
+  std::string::size_type n = log_name.rfind('/');
+  std::string directory =
+      n == std::string::npos ? "" : log_name.substr(0, n + 1);
+  std::string prefix = log_name.substr(directory.size()) + ".";
+  DIR *dir = opendir(directoryOf(log_name).c_str());
+  if (dir == nullptr) {
+    return names;
+  }
+  while (struct dirent *entry = readdir(dir)) {
+    if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+      names.push_back(directory + entry->d_name);
+    }
+  }
+  closedir(dir);
+  return names;
+}
+
+// makes the files created, renamed or removed in a directory durable
+static void syncDirectory(const std::string &directory) {
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0 || fsync(fd) != 0) {
+    LOG_DEBUG("I/O error while syncing directory");
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+static bool writeZeros(int fd, off_t offset, off_t end) {
+  std::vector<char> zeros(std::min<off_t>(end - offset, 1 << 20), 0);
+  while (offset < end) {
+    size_t count = std::min<off_t>(zeros.size(), end - offset);
+    if (WriteFully(fd, zeros.data(), count, offset) !=
+        static_cast<ssize_t>(count)) {
+      return false;
+    }
+    offset += count;
+  }
+  return true;
+}
 
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
 DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), flush_log_(false),
-      flush_log_f_(nullptr) {
+    : DiskManager(db_file, Options()) {}
+
+/**
+ * @input options.page_size: page size of a new database, a power of two
+ * between MIN_PAGE_SIZE and MAX_PAGE_SIZE. An existing database keeps the
+ * page size recorded in its header page (in its page map if it is compressed)
+ */
+DiskManager::DiskManager(const std::string &db_file, const Options &options)
+    : log_fd_(-1), log_segment_(-1), log_size_(0), log_start_(0),
+      log_segment_size_(options.log_segment_size), read_fd_(-1),
+      read_segment_(-1), file_name_(db_file), db_fd_(-1),
+      page_size_(options.page_size), direct_io_(false),
+      direct_io_align_(MIN_PAGE_SIZE), read_only_(options.read_only),
+      mapping_(nullptr), mapping_size_(0),
+      async_io_(AsyncIO::Create(options.use_io_uring)), bytes_read_(0),
+      bytes_written_(0), compress_(false),
+      sector_size_(COMPRESSED_SECTOR_SIZE), map_fd_(-1), num_sectors_(0),
+      next_page_id_(0), num_free_pages_(0), free_hint_(0), fsm_fd_(-1),
+      num_flushes_(0), flush_log_(false), flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.find(".");
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  fsm_name_ = file_name_.substr(0, n) + ".fsm";
+  map_name_ = file_name_.substr(0, n) + ".map";
+
+  openLog();
+  if (read_only_) {
+    if (GetFileSize(map_name_) >= 0) {
+      throw Exception(EXCEPTION_TYPE_NOT_IMPLEMENTED,
+                      "compressed database " + db_file +
+                          " can not be opened read only");
+    }
+    int stored_page_size = readPageSize(db_file);
+    if (stored_page_size != 0) {
+      page_size_ = stored_page_size;
+    }
+    mapFile();
+    next_page_id_ = GetNumPages();
+    return;
+  }
+  // the header page of a compressed database is compressed as well, its page
+  // size is in the page map
+  compress_ = loadPageMap();
+  if (!compress_) {
+    int stored_page_size = readPageSize(db_file);
+    if (stored_page_size != 0) {
+      page_size_ = stored_page_size;
+    }
+  }
+  if (!IsValidPageSize(page_size_)) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                    "page size " + std::to_string(page_size_) +
+                        " is not a power of two between " +
+                        std::to_string(MIN_PAGE_SIZE) + " and " +
+                        std::to_string(MAX_PAGE_SIZE));
+  }
+  if (options.compress && !compress_ && GetFileSize(db_file) <= 0) {
+    compress_ = createPageMap();
+  }
+  if (options.direct_io && compress_) {
+    // compressed pages are not sector aligned
+    LOG_DEBUG("compressed database, using buffered I/O");
+  } else if (options.direct_io) {
+    direct_io_ = openDirect(db_file);
+  }
+  if (!direct_io_) {
+    db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+  }
+  if (db_fd_ < 0) {
+    LOG_DEBUG("can not open db file");
+  }
+  // pages past the end of the file were never written, their ids are free
+  next_page_id_ = GetNumPages();
+  loadFreePages();
+}
+
+bool DiskManager::IsValidPageSize(int page_size) {
+  return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+         (page_size & (page_size - 1)) == 0;
+}
+
+/**
+ * The page size recorded in the header page of an existing db file, 0 if
+ * there is none. Read before the page size is known, and before the file is
+ * opened for O_DIRECT, which could not read a few bytes
+ */
+int DiskManager::readPageSize(const std::string &db_file) {
+  int fd = open(db_file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  // the header page is the first page of the file
+  char header[HEADER_PAGE_PREFIX_SIZE];
+  ssize_t read_count = ReadFully(fd, header, sizeof(header), 0);
+  close(fd);
+  if (read_count != sizeof(header)) {
+    return 0;
+  }
+  int page_size = HeaderPage::ReadPageSize(header);
+  if (page_size != 0 && !IsValidPageSize(page_size)) {
+    LOG_DEBUG("invalid page size %d in header page", page_size);
+    return 0;
+  }
+  return page_size;
+}
 
-  log_io_.open(log_name_,
-               std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app |
-                                std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app |
-                                std::ios::out);
-  }
-
-  db_io_.open(db_file,
-              std::ios::binary | std::ios::in | std::ios::out | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+/**
+ * Open the db file with O_DIRECT if the file system takes direct I/O of
+ * whole pages into page aligned buffers
+ */
+bool DiskManager::openDirect(const std::string &db_file) {
+  int fd = open(db_file.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+  if (fd < 0) {
+    LOG_DEBUG("O_DIRECT not supported, using buffered I/O");
+    return false;
   }
+#ifdef STATX_DIOALIGN
+  struct statx stx;
+  if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 &&
+      (stx.stx_mask & STATX_DIOALIGN)) {
+    if (stx.stx_dio_offset_align == 0 ||
+        page_size_ % stx.stx_dio_offset_align != 0 ||
+        page_size_ % stx.stx_dio_mem_align != 0) {
+      LOG_DEBUG("direct I/O alignment is larger than a page, using buffered "
+                "I/O");
+      close(fd);
+      return false;
+    }
+    direct_io_align_ = std::max<int>(stx.stx_dio_mem_align, 1);
+  }
+#endif
+  db_fd_ = fd;
+  return true;
+}
+
+/**
+ * Open the db file read only and map its whole pages. The mapping is shared,
+ * so it costs no memory beyond the OS page cache
+ */
+void DiskManager::mapFile() {
+  db_fd_ = open(file_name_.c_str(), O_RDONLY);
+  if (db_fd_ < 0) {
+    throw Exception(EXCEPTION_TYPE_IO, "can not open db file " + file_name_);
+  }
+  mapping_size_ = std::max<off_t>(GetFileSize(db_fd_), 0) / page_size_ *
+                  static_cast<size_t>(page_size_);
+  if (mapping_size_ == 0) {
+    return;
+  }
+  void *mapping =
+      mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, db_fd_, 0);
+  if (mapping == MAP_FAILED) {
+    close(db_fd_);
+    throw Exception(EXCEPTION_TYPE_IO, "can not map db file " + file_name_);
+  }
+  mapping_ = static_cast<char *>(mapping);
+}
+
+void DiskManager::AdviseMappedPages(page_id_t page_id, int count) {
+  if (mapping_ == nullptr || page_id < 0 || count <= 0) {
+    return;
+  }
+  size_t offset = static_cast<size_t>(page_id) * page_size_;
+  if (offset >= mapping_size_) {
+    return;
+  }
+  size_t length = std::min(static_cast<size_t>(count) * page_size_,
+                           mapping_size_ - offset);
+  madvise(mapping_ + offset, length, MADV_WILLNEED);
 }
 
 DiskManager::~DiskManager() {
-  db_io_.close();
-  log_io_.close();
+  // waits for the I/Os in flight
+  delete async_io_;
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+  }
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+  }
+  if (read_fd_ >= 0) {
+    close(read_fd_);
+  }
+  if (fsm_fd_ >= 0) {
+    close(fsm_fd_);
+  }
+  if (map_fd_ >= 0) {
+    close(map_fd_);
+  }
 }
 
 /**
  * Write the contents of the specified page into disk file
+ * Positional I/O on the descriptor, so no latch is needed: any number of
+ * threads can read and write different pages at the same time.
+ * The checksum is computed over a private copy of the page and written from
+ * it, so a page that is changed while it is written (e.g. flushed while
+ * pinned) still reaches the disk with a matching checksum. The copy is
+ * aligned for O_DIRECT as well.
+ * A compressed page goes to sectors nobody else uses, its old place is only
+ * given up once the new one is written
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = page_id * PAGE_SIZE;
-  // set write cursor to offset
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
+  char *stored = allocateAligned();
+  int length = encodePage(page_id, page_data, stored);
+  off_t offset = static_cast<off_t>(page_id) * page_size_;
+  PageLocation location{0, static_cast<uint32_t>(length)};
+  if (compress_) {
+    location.sector = reserveSectors(sectorsOf(length));
+    offset = static_cast<off_t>(location.sector) * sector_size_;
+  }
   // check for I/O error
-  if (db_io_.bad()) {
+  bool ok = WriteFully(db_fd_, stored, length, offset) == length;
+  if (!ok) {
     LOG_DEBUG("I/O error while writing");
-    return;
+  } else {
+    bytes_written_ += length;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  if (compress_) {
+    finishWrite(page_id, location, ok);
+  }
+  free(stored);
 }
 
 /**
  * Read the contents of the specified page into the given memory area
+ * A page past the end of the file was never written and reads as zeros. One
+ * cut short by it is zero filled and fails its checksum
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
+bool DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  if (compress_) {
+    PageLocation location = lookupPage(page_id);
+    if (location.length == 0) {
+      memset(page_data, 0, page_size_);
+      return true;
+    }
+    int length = location.length;
+    // a page that did not compress is read in place
+    char *stored = length == page_size_ ? page_data
+                                        : static_cast<char *>(malloc(length));
+    ssize_t read_count =
+        ReadFully(db_fd_, stored, length,
+                  static_cast<off_t>(location.sector) * sector_size_);
+    bool ok = read_count == length;
+    if (!ok) {
+      LOG_DEBUG("I/O error while reading");
+      memset(page_data, 0, page_size_);
+    } else {
+      bytes_read_ += length;
+      ok = decodePage(page_id, stored, length, page_data);
+    }
+    if (stored != page_data) {
+      free(stored);
+    }
+    return ok;
+  }
+  if (needsBounce(page_data)) {
+    char *aligned = allocateAligned();
+    bool ok = ReadPage(page_id, aligned);
+    memcpy(page_data, aligned, page_size_);
+    free(aligned);
+    return ok;
+  }
+  off_t offset = static_cast<off_t>(page_id) * page_size_;
+  ssize_t read_count = ReadFully(db_fd_, page_data, page_size_, offset);
+  if (read_count < 0) {
     LOG_DEBUG("I/O error while reading");
-    // std::cerr << "I/O error while reading" << std::endl;
+    memset(page_data, 0, page_size_);
+    return false;
+  }
+  bytes_read_ += read_count;
+  if (read_count < page_size_) {
+    // if file ends before reading a page
+    LOG_DEBUG("Read less than a page");
+    memset(page_data + read_count, 0, page_size_ - read_count);
+  }
+  return read_count == 0 || verifyChecksum(page_id, page_data);
+}
+
+void DiskManager::WritePageAsync(page_id_t page_id, const char *page_data,
+                                 std::function<void(bool)> callback) {
+  char *stored = allocateAligned();
+  int length = encodePage(page_id, page_data, stored);
+  off_t offset = static_cast<off_t>(page_id) * page_size_;
+  PageLocation location{0, static_cast<uint32_t>(length)};
+  if (compress_) {
+    location.sector = reserveSectors(sectorsOf(length));
+    offset = static_cast<off_t>(location.sector) * sector_size_;
+  }
+  async_io_->Write(db_fd_, stored, length, offset,
+                   [this, page_id, stored, length, location,
+                    callback](ssize_t result) {
+                     free(stored);
+                     // check for I/O error
+                     bool ok = result == length;
+                     if (!ok) {
+                       LOG_DEBUG("I/O error while writing");
+                     } else {
+                       bytes_written_ += length;
+                     }
+                     if (compress_) {
+                       finishWrite(page_id, location, ok);
+                     }
+                     callback(ok);
+                   });
+}
+
+/**
+ * A page past the end of the file reads as zeros, one cut short by it fails
+ * its checksum like in ReadPage()
+ */
+void DiskManager::ReadPageAsync(page_id_t page_id, char *page_data,
+                                std::function<void(bool)> callback) {
+  int page_size = page_size_;
+  if (compress_) {
+    PageLocation location = lookupPage(page_id);
+    if (location.length == 0) {
+      memset(page_data, 0, page_size);
+      callback(true);
+      return;
+    }
+    int length = location.length;
+    char *stored = length == page_size ? page_data
+                                       : static_cast<char *>(malloc(length));
+    async_io_->Read(db_fd_, stored, length,
+                    static_cast<off_t>(location.sector) * sector_size_,
+                    [this, page_id, page_data, stored, length,
+                     callback](ssize_t result) {
+                      bool ok = result == length;
+                      if (!ok) {
+                        LOG_DEBUG("I/O error while reading");
+                      } else {
+                        bytes_read_ += length;
+                        ok = decodePage(page_id, stored, length, page_data);
+                      }
+                      if (stored != page_data) {
+                        free(stored);
+                      }
+                      callback(ok);
+                    });
+    return;
+  }
+  if (needsBounce(page_data)) {
+    char *aligned = allocateAligned();
+    ReadPageAsync(page_id, aligned,
+                  [aligned, page_data, page_size, callback](bool ok) {
+                    memcpy(page_data, aligned, page_size);
+                    free(aligned);
+                    callback(ok);
+                  });
+    return;
+  }
+  off_t offset = static_cast<off_t>(page_id) * page_size;
+  async_io_->Read(db_fd_, page_data, page_size, offset,
+                  [this, page_id, page_data, page_size,
+                   callback](ssize_t result) {
+                    if (result < 0) {
+                      LOG_DEBUG("I/O error while reading");
+                      callback(false);
+                      return;
+                    }
+                    bytes_read_ += result;
+                    // if file ends before reading a page
+                    if (result < page_size) {
+                      LOG_DEBUG("Read less than a page");
+                      memset(page_data + result, 0, page_size - result);
+                    }
+                    callback(result == 0 ||
+                             verifyChecksum(page_id, page_data));
+                  });
+}
+
+std::future<bool> DiskManager::WritePageAsync(page_id_t page_id,
+                                              const char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  WritePageAsync(page_id, page_data,
+                 [promise](bool ok) { promise->set_value(ok); });
+  return promise->get_future();
+}
+
+std::future<bool> DiskManager::ReadPageAsync(page_id_t page_id,
+                                             char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  ReadPageAsync(page_id, page_data,
+                [promise](bool ok) { promise->set_value(ok); });
+  return promise->get_future();
+}
+
+/**
+ * Write a run of consecutive pages starting at page_id, one write per
+ * WRITE_BATCH_PAGES pages instead of a seek + write + flush per page. The
+ * pages are checksummed in a copy like in WritePage(), the copies of a batch
+ * sit next to each other. Compressed pages of a batch are packed into one
+ * run of sectors. Like WritePage(), it only hands the data to the OS, call
+ * SyncDB() to make it durable
+ */
+void DiskManager::WritePages(page_id_t page_id,
+                             const std::vector<const char *> &pages) {
+  size_t batch_pages = std::min<size_t>(pages.size(), WRITE_BATCH_PAGES);
+  if (batch_pages == 0) {
+    return;
+  }
+  char *batch = static_cast<char *>(
+      aligned_alloc(direct_io_align_, batch_pages * page_size_));
+  std::vector<PageLocation> locations(batch_pages);
+  for (size_t first = 0; first < pages.size(); first += batch_pages) {
+    size_t count = std::min(batch_pages, pages.size() - first);
+    ssize_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+      int length =
+          encodePage(page_id + first + i, pages[first + i], batch + size);
+      // sectors relative to the batch
+      locations[i] = {static_cast<uint32_t>(size / sector_size_),
+                      static_cast<uint32_t>(length)};
+      size += compress_ ? sectorsOf(length) * sector_size_ : page_size_;
+    }
+    off_t offset = static_cast<off_t>(page_id + first) * page_size_;
+    uint32_t first_sector = 0;
+    if (compress_) {
+      first_sector = reserveSectors(size / sector_size_);
+      offset = static_cast<off_t>(first_sector) * sector_size_;
+    }
+    bool ok = WriteFully(db_fd_, batch, size, offset) == size;
+    if (!ok) {
+      LOG_DEBUG("I/O error while writing");
+    } else {
+      bytes_written_ += size;
+    }
+    if (compress_) {
+      std::lock_guard<std::mutex> guard(map_latch_);
+      if (ok) {
+        for (size_t i = 0; i < count; i++) {
+          locations[i].sector += first_sector;
+          placePage(page_id + first + i, locations[i]);
+        }
+      } else {
+        pending_free_sectors_.emplace_back(first_sector, size / sector_size_);
+      }
+    }
+    if (!ok) {
+      break;
+    }
+  }
+  free(batch);
+}
+
+/**
+ * The bytes stored for a page: a checksummed copy of it, LZ4 compressed for
+ * a compressed database unless that does not save a sector. Returns their
+ * length, stored has room for a page
+ */
+int DiskManager::encodePage(page_id_t page_id, const char *page_data,
+                            char *stored) const {
+  if (!compress_) {
+    memcpy(stored, page_data, page_size_);
+    stampChecksum(page_id, stored);
+    return page_size_;
+  }
+  char *copy = static_cast<char *>(malloc(page_size_));
+  memcpy(copy, page_data, page_size_);
+  stampChecksum(page_id, copy);
+  int length =
+      LZ4Compress(copy, page_size_, stored, page_size_ - sector_size_);
+  if (length == 0) {
+    memcpy(stored, copy, page_size_);
+    length = page_size_;
+  }
+  free(copy);
+  return length;
+}
+
+/**
+ * Turn length bytes stored for a page back into the page and verify it. A
+ * page that did not compress may have been read into page_data already
+ */
+bool DiskManager::decodePage(page_id_t page_id, const char *stored, int length,
+                             char *page_data) const {
+  if (length != page_size_) {
+    if (LZ4Decompress(stored, length, page_data, page_size_) != page_size_) {
+      LOG_DEBUG("page %d can not be decompressed", page_id);
+      memset(page_data, 0, page_size_);
+      return false;
+    }
+  } else if (stored != page_data) {
+    memcpy(page_data, stored, page_size_);
+  }
+  return verifyChecksum(page_id, page_data);
+}
+
+/**
+ * Read the page map of a compressed database, and with it its page and sector
+ * size. Returns false if there is none. The free runs are the gaps between
+ * the sectors the pages occupy
+ */
+bool DiskManager::loadPageMap() {
+  map_fd_ = open(map_name_.c_str(), O_RDWR);
+  if (map_fd_ < 0) {
+    return false;
+  }
+  uint32_t header[PAGE_MAP_HEADER_SIZE / sizeof(uint32_t)];
+  if (ReadFully(map_fd_, reinterpret_cast<char *>(header), sizeof(header),
+                0) != sizeof(header) ||
+      header[0] != PAGE_MAP_MAGIC || !IsValidPageSize(header[1]) ||
+      header[2] == 0) {
+    LOG_DEBUG("invalid page map %s", map_name_.c_str());
+    close(map_fd_);
+    map_fd_ = -1;
+    return false;
+  }
+  page_size_ = header[1];
+  sector_size_ = header[2];
+  off_t size =
+      std::max<off_t>(GetFileSize(map_fd_) - PAGE_MAP_HEADER_SIZE, 0);
+  page_map_.resize(size / sizeof(PageLocation));
+  size = page_map_.size() * sizeof(PageLocation);
+  if (ReadFully(map_fd_, reinterpret_cast<char *>(page_map_.data()), size,
+                PAGE_MAP_HEADER_SIZE) != size) {
+    LOG_DEBUG("I/O error while reading page map");
+    page_map_.clear();
+  }
+  std::map<uint32_t, uint32_t> used;
+  for (const PageLocation &location : page_map_) {
+    if (location.length != 0) {
+      used[location.sector] = sectorsOf(location.length);
+    }
+  }
+  for (const auto &run : used) {
+    if (run.first > num_sectors_) {
+      free_sectors_[num_sectors_] = run.first - num_sectors_;
+    }
+    num_sectors_ = std::max(num_sectors_, run.first + run.second);
+  }
+  return true;
+}
+
+/**
+ * Start the page map of a new compressed database
+ */
+bool DiskManager::createPageMap() {
+  map_fd_ = open(map_name_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (map_fd_ < 0) {
+    LOG_DEBUG("can not create page map, storing pages uncompressed");
+    return false;
+  }
+  uint32_t header[PAGE_MAP_HEADER_SIZE / sizeof(uint32_t)] = {
+      PAGE_MAP_MAGIC, static_cast<uint32_t>(page_size_), sector_size_, 0};
+  if (WriteFully(map_fd_, reinterpret_cast<const char *>(header),
+                 sizeof(header), 0) != sizeof(header)) {
+    LOG_DEBUG("can not create page map, storing pages uncompressed");
+    close(map_fd_);
+    map_fd_ = -1;
+    unlink(map_name_.c_str());
+    return false;
+  }
+  return true;
+}
+
+DiskManager::PageLocation DiskManager::lookupPage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(map_latch_);
+  if (page_id < 0 || static_cast<size_t>(page_id) >= page_map_.size()) {
+    return PageLocation{0, 0};
+  }
+  return page_map_[page_id];
+}
+
+/**
+ * Sectors for a page being written. The page keeps its old ones until
+ * finishWrite(), so a failed or torn write leaves the old version readable.
+ * Sectors given up, by a page or by a failed write, all wait for the next
+ * SyncDB() to be reused
+ */
+uint32_t DiskManager::reserveSectors(uint32_t count) {
+  std::lock_guard<std::mutex> guard(map_latch_);
+  return allocateSectors(count);
+}
+
+void DiskManager::finishWrite(page_id_t page_id, PageLocation location,
+                              bool ok) {
+  std::lock_guard<std::mutex> guard(map_latch_);
+  if (ok) {
+    placePage(page_id, location);
+  } else {
+    pending_free_sectors_.emplace_back(location.sector,
+                                       sectorsOf(location.length));
+  }
+}
+
+/**
+ * Point the page map entry of page_id at location, on disk too. The sectors
+ * the page had before are freed by the next SyncDB(): until the map is
+ * synced, a crash can leave the entry on disk pointing at them, and another
+ * page written there would read back as this one
+ */
+void DiskManager::placePage(page_id_t page_id, PageLocation location) {
+  if (static_cast<size_t>(page_id) >= page_map_.size()) {
+    if (location.length == 0) {
+      return;
+    }
+    page_map_.resize(std::max<size_t>(page_id + 1, page_map_.size() * 2));
+  }
+  PageLocation old = page_map_[page_id];
+  page_map_[page_id] = location;
+  if (WriteFully(map_fd_, reinterpret_cast<const char *>(&location),
+                 sizeof(location),
+                 PAGE_MAP_HEADER_SIZE + static_cast<off_t>(page_id) *
+                                            sizeof(PageLocation)) !=
+      sizeof(location)) {
+    LOG_DEBUG("I/O error while writing page map");
+  }
+  if (old.length != 0) {
+    pending_free_sectors_.emplace_back(old.sector, sectorsOf(old.length));
+  }
+}
+
+/**
+ * First fit among the free runs, the end of the file if none is long enough
+ */
+uint32_t DiskManager::allocateSectors(uint32_t count) {
+  for (auto it = free_sectors_.begin(); it != free_sectors_.end(); ++it) {
+    if (it->second < count) {
+      continue;
+    }
+    uint32_t sector = it->first;
+    uint32_t rest = it->second - count;
+    free_sectors_.erase(it);
+    if (rest != 0) {
+      free_sectors_[sector + count] = rest;
+    }
+    return sector;
+  }
+  uint32_t sector = num_sectors_;
+  num_sectors_ += count;
+  return sector;
+}
+
+void DiskManager::freeSectors(uint32_t sector, uint32_t count) {
+  auto next = free_sectors_.lower_bound(sector);
+  if (next != free_sectors_.end() && sector + count == next->first) {
+    count += next->second;
+    next = free_sectors_.erase(next);
+  }
+  if (next != free_sectors_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == sector) {
+      sector = prev->first;
+      count += prev->second;
+      free_sectors_.erase(prev);
+    }
+  }
+  if (sector + count == num_sectors_) {
+    num_sectors_ = sector;
   } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    free_sectors_[sector] = count;
+  }
+}
+
+bool DiskManager::VerifyPage(page_id_t page_id, const char *page_data) const {
+  return verifyChecksum(page_id, page_data);
+}
+
+/**
+ * The CRC32C of the page id and everything before the trailer. With the page
+ * id in it, a page written to the offset of another one fails as that one,
+ * and an all zero page fails like any other
+ */
+uint32_t DiskManager::pageChecksum(page_id_t page_id,
+                                   const char *page_data) const {
+  uint32_t crc =
+      Crc32c(reinterpret_cast<const char *>(&page_id), sizeof(page_id_t));
+  return Crc32c(page_data, page_size_ - PAGE_CHECKSUM_SIZE, crc);
+}
+
+/**
+ * Store the checksum of the page in its trailer
+ */
+void DiskManager::stampChecksum(page_id_t page_id, char *page_data) const {
+  uint32_t checksum = pageChecksum(page_id, page_data);
+  memcpy(page_data + page_size_ - PAGE_CHECKSUM_SIZE, &checksum,
+         PAGE_CHECKSUM_SIZE);
+}
+
+bool DiskManager::verifyChecksum(page_id_t page_id,
+                                 const char *page_data) const {
+  uint32_t stored;
+  memcpy(&stored, page_data + page_size_ - PAGE_CHECKSUM_SIZE,
+         PAGE_CHECKSUM_SIZE);
+  if (stored != pageChecksum(page_id, page_data)) {
+    LOG_DEBUG("checksum mismatch on page %d", page_id);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Flush the db file to stable storage
+ */
+void DiskManager::SyncDB() {
+  if (fsync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+  // the pages first, then the map pointing at them. The sectors given up
+  // before the map sync are free once it is done
+  if (map_fd_ >= 0) {
+    std::vector<std::pair<uint32_t, uint32_t>> pending;
+    {
+      std::lock_guard<std::mutex> guard(map_latch_);
+      pending.swap(pending_free_sectors_);
+    }
+    bool synced = fsync(map_fd_) == 0;
+    if (!synced) {
+      LOG_DEBUG("I/O error while syncing");
+    }
+    std::lock_guard<std::mutex> guard(map_latch_);
+    for (const auto &run : pending) {
+      if (synced) {
+        freeSectors(run.first, run.second);
+      } else {
+        pending_free_sectors_.push_back(run);
+      }
+    }
+    // give back the free sectors at the end of the file, the next sync makes
+    // it durable
+    if (ftruncate(db_fd_, static_cast<off_t>(num_sectors_) * sector_size_) !=
+        0) {
+      LOG_DEBUG("I/O error while truncating");
     }
   }
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  if (fsm_fd_ >= 0 && fsync(fsm_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+  }
 }
 
 /**
@@ -105,10 +828,6 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
  * Only return when sync is done, and only perform sequence write
  */
 void DiskManager::WriteLog(char *log_data, int size) {
-  // enforce swap log buffer
-  assert(log_data != buffer_used);
-  buffer_used = log_data;
-
   if (size == 0) // no effect on num_flushes_ if log buffer is empty
     return;
 
@@ -120,54 +839,425 @@ void DiskManager::WriteLog(char *log_data, int size) {
            std::future_status::ready);
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
+  // sequence write. A write crossing into the next segment is synced part by
+  // part, a segment never holds records the one before misses
+  lsn_t offset = log_size_;
+  int done = 0;
+  while (done < size) {
+    if (!switchLogSegment(offset / log_segment_size_)) {
+      LOG_DEBUG("can not open log segment");
+      return;
+    }
+    int position = static_cast<int>(offset % log_segment_size_);
+    int count = std::min(size - done, log_segment_size_ - position);
+    ssize_t written = WriteFully(log_fd_, log_data + done, count, position);
 
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+    // check for I/O error
+    if (written != count) {
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+    if (fdatasync(log_fd_) != 0) {
+      LOG_DEBUG("I/O error while syncing log");
+      return;
+    }
+    done += count;
+    offset += count;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
+  log_size_ = offset;
   flush_log_ = false;
 }
 
+/**
+ * Drop the log after size, later writes continue there. The rest of the
+ * segment of size is zeroed and later segments are removed, so that nothing
+ * after the records written next reads as a record. They do not become spare
+ * segments, one could come back as the same segment
+ */
+void DiskManager::TruncateLog(lsn_t size) {
+  if (read_only_ || size >= log_size_) {
+    return;
+  }
+  lsn_t keep = (size + log_segment_size_ - 1) / log_segment_size_;
+  lsn_t end = (log_size_ + log_segment_size_ - 1) / log_segment_size_;
+  if (log_segment_ >= keep && log_fd_ >= 0) {
+    close(log_fd_);
+    log_fd_ = -1;
+  }
+  {
+    std::lock_guard<std::mutex> guard(log_latch_);
+    if (read_segment_ >= keep && read_fd_ >= 0) {
+      close(read_fd_);
+      read_fd_ = -1;
+      read_segment_ = -1;
+    }
+    for (lsn_t segment = keep; segment < end; segment++) {
+      remove(segmentName(segment).c_str());
+    }
+  }
+  if (size % log_segment_size_ != 0 &&
+      (!switchLogSegment(size / log_segment_size_) ||
+       !writeZeros(log_fd_, size % log_segment_size_, log_segment_size_) ||
+       fdatasync(log_fd_) != 0)) {
+    LOG_DEBUG("I/O error while truncating log");
+    return;
+  }
+  syncDirectory(directoryOf(log_name_));
+  log_size_ = size;
+}
+
+/**
+ * Segments before the one appended to are given up whole
+ */
+void DiskManager::DiscardLogBefore(lsn_t offset) {
+  if (read_only_) {
+    return;
+  }
+  lsn_t first = log_start_ / log_segment_size_;
+  lsn_t end = std::min<lsn_t>(offset, log_size_) / log_segment_size_;
+  if (end <= first) {
+    return;
+  }
+  log_start_ = end * log_segment_size_;
+  for (lsn_t segment = first; segment < end; segment++) {
+    releaseLogSegment(segment);
+  }
+  syncDirectory(directoryOf(log_name_));
+  std::lock_guard<std::mutex> guard(log_latch_);
+  if (!archive_directory_.empty()) {
+    syncDirectory(archive_directory_);
+  }
+}
+
 /**
  * Read the contents of the log into the given memory area
- * Always read from the beginning and perform sequence read
- * @return: false means already reach the end
+ * Always read from the beginning and perform sequence read. Bytes past the
+ * end of the log, or in a segment that is missing, read as zeros
+ * @return: false means already reach the end, or offset was discarded
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
-    // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
+bool DiskManager::ReadLog(char *log_data, int size, lsn_t offset) {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  lsn_t end = log_size_;
+  if (offset < log_start_ || offset >= end) {
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+  int done = 0;
+  while (done < size && offset + done < end) {
+    lsn_t segment = (offset + done) / log_segment_size_;
+    int position = static_cast<int>((offset + done) % log_segment_size_);
+    int count = static_cast<int>(std::min<lsn_t>(
+        {size - done, log_segment_size_ - position, end - offset - done}));
+    if (segment != read_segment_) {
+      if (read_fd_ >= 0) {
+        close(read_fd_);
+      }
+      read_fd_ = open(segmentName(segment).c_str(), O_RDONLY);
+      read_segment_ = segment;
+    }
+    ssize_t read_count =
+        read_fd_ < 0 ? 0
+                     : ReadFully(read_fd_, log_data + done, count, position);
+    if (read_count < 0) {
+      LOG_DEBUG("I/O error while reading log");
+      read_count = 0;
+    }
+    memset(log_data + done + read_count, 0, count - read_count);
+    done += count;
   }
-
+  memset(log_data + done, 0, size - done);
   return true;
 }
 
+/**
+ * Find the segments of an existing log. Nothing is created, the first
+ * WriteLog() creates the segment it writes to
+ */
+void DiskManager::openLog() {
+  lsn_t first = -1, last = -1;
+  for (auto &name : listLogFiles(log_name_)) {
+    std::string suffix = name.substr(log_name_.size() + 1);
+    char *end;
+    lsn_t segment = strtoll(suffix.c_str(), &end, 16);
+    bool is_spare = suffix.compare(0, 5, "spare") == 0;
+    if (!is_spare && (suffix.size() != 16 || *end != '\0')) {
+      // e.g. a new segment whose zeros were not all written
+      continue;
+    }
+    // an existing log keeps the size of its segments
+    off_t file_size = GetFileSize(name);
+    if (file_size > 0) {
+      log_segment_size_ = static_cast<int>(file_size);
+    }
+    if (is_spare) {
+      spare_segments_.push_back(name);
+      continue;
+    }
+    first = first < 0 ? segment : std::min(first, segment);
+    last = std::max(last, segment);
+  }
+  if (log_segment_size_ <= 0) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                    "log segment size " + std::to_string(log_segment_size_) +
+                        " is not positive");
+  }
+  if (last >= 0) {
+    log_start_ = first * log_segment_size_;
+    log_size_ = (last + 1) * log_segment_size_;
+  }
+}
+
+std::string DiskManager::segmentName(lsn_t segment) const {
+  char suffix[24];
+  snprintf(suffix, sizeof(suffix), ".%016llx",
+           static_cast<unsigned long long>(segment));
+  return log_name_ + suffix;
+}
+
+/**
+ * Point log_fd_ to a segment, creating it if it does not exist yet
+ */
+bool DiskManager::switchLogSegment(lsn_t segment) {
+  if (segment == log_segment_ && log_fd_ >= 0) {
+    return true;
+  }
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+  }
+  std::string name = segmentName(segment);
+  log_fd_ = open(name.c_str(), O_RDWR);
+  if (log_fd_ < 0) {
+    log_fd_ = createLogSegment(name);
+  }
+  log_segment_ = segment;
+  return log_fd_ >= 0;
+}
+
+/**
+ * A spare segment if there is one, a file written full of zeros otherwise.
+ * Renamed to name once it is complete
+ */
+int DiskManager::createLogSegment(const std::string &name) {
+  std::string source;
+  {
+    std::lock_guard<std::mutex> guard(log_latch_);
+    if (!spare_segments_.empty()) {
+      source = spare_segments_.back();
+      spare_segments_.pop_back();
+    }
+  }
+  if (source.empty()) {
+    source = log_name_ + ".new";
+    int fd = open(source.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      return -1;
+    }
+    bool ok = writeZeros(fd, 0, log_segment_size_) && fsync(fd) == 0;
+    close(fd);
+    if (!ok) {
+      LOG_DEBUG("I/O error while creating log segment");
+      return -1;
+    }
+  }
+  if (rename(source.c_str(), name.c_str()) != 0) {
+    LOG_DEBUG("can not create log segment");
+    return -1;
+  }
+  syncDirectory(directoryOf(log_name_));
+  return open(name.c_str(), O_RDWR);
+}
+
+/**
+ * A segment discarded from the log is archived, kept as a spare segment or
+ * removed. A spare one only comes back as a later segment, where its old
+ * records do not have the LSN of their offset
+ */
+void DiskManager::releaseLogSegment(lsn_t segment) {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  if (segment == read_segment_ && read_fd_ >= 0) {
+    close(read_fd_);
+    read_fd_ = -1;
+    read_segment_ = -1;
+  }
+  std::string name = segmentName(segment);
+  if (access(name.c_str(), F_OK) != 0) {
+    return;
+  }
+  if (!archive_directory_.empty()) {
+    std::string target =
+        archive_directory_ + "/" + name.substr(name.rfind('/') + 1);
+    if (rename(name.c_str(), target.c_str()) != 0) {
+      LOG_DEBUG("can not archive log segment");
+    }
+    return;
+  }
+  if (spare_segments_.size() < LOG_SPARE_SEGMENTS) {
+    std::string spare =
+        log_name_ + ".spare" + name.substr(log_name_.size() + 1);
+    if (rename(name.c_str(), spare.c_str()) == 0) {
+      spare_segments_.push_back(spare);
+      return;
+    }
+  }
+  remove(name.c_str());
+}
+
+void DiskManager::RemoveLogFiles(const std::string &db_file) {
+  std::string::size_type n = db_file.find(".");
+  if (n == std::string::npos) {
+    return;
+  }
+  for (auto &name : listLogFiles(db_file.substr(0, n) + ".log")) {
+    remove(name.c_str());
+  }
+}
+
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * The lowest free page if there is one, a new page at the end of the file
+ * otherwise. O(1) amortized: the search starts at free_hint_, and every word it
+ * skips had its last free page taken since the hint was moved back
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage() {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  if (num_free_pages_ == 0) {
+    return next_page_id_++;
+  }
+  while (free_pages_[free_hint_] == 0) {
+    free_hint_++;
+  }
+  uint64_t &word = free_pages_[free_hint_];
+  page_id_t page_id = free_hint_ * 64 + __builtin_ctzll(word);
+  word &= word - 1;
+  num_free_pages_--;
+  persistFreePages(free_hint_);
+  return page_id;
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
+ * The page is handed out again by a later AllocatePage(), the file does not
+ * shrink. A compressed database frees the sectors of the page with the next
+ * SyncDB(), a read only one ignores the call
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-  return;
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  if (read_only_ || page_id < 0 || page_id >= next_page_id_) {
+    return;
+  }
+  size_t index = page_id / 64;
+  uint64_t bit = 1ull << (page_id % 64);
+  if (index >= free_pages_.size()) {
+    free_pages_.resize(std::max(index + 1, free_pages_.size() * 2));
+  }
+  if (free_pages_[index] & bit) {
+    LOG_DEBUG("page %d deallocated twice", page_id);
+    return;
+  }
+  free_pages_[index] |= bit;
+  num_free_pages_++;
+  if (compress_) {
+    std::lock_guard<std::mutex> map_guard(map_latch_);
+    placePage(page_id, PageLocation{0, 0});
+  }
+  free_hint_ = std::min(free_hint_, index);
+  if (fsm_fd_ < 0) {
+    fsm_fd_ = open(fsm_name_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fsm_fd_ < 0) {
+      LOG_DEBUG("can not open free space map");
+    }
+  }
+  persistFreePages(index);
+}
+
+/**
+ * Extents always come from the end of the file, free pages are too scattered
+ * to make one
+ */
+page_id_t DiskManager::AllocateExtent(int count) {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  page_id_t page_id = next_page_id_;
+  next_page_id_ += count;
+  return page_id;
+}
+
+void DiskManager::MarkPageAllocated(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  if (page_id >= next_page_id_) {
+    next_page_id_ = page_id + 1;
+    return;
+  }
+  size_t index = page_id / 64;
+  uint64_t bit = 1ull << (page_id % 64);
+  if (index < free_pages_.size() && (free_pages_[index] & bit)) {
+    free_pages_[index] &= ~bit;
+    num_free_pages_--;
+    persistFreePages(index);
+  }
+}
+
+size_t DiskManager::GetNumFreePages() {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  return num_free_pages_;
+}
+
+/**
+ * Read the free space map left by an earlier run. Pages at or past
+ * next_page_id_ are free anyway, their bits are dropped, on disk too: they must
+ * not come back once the file has grown past them
+ */
+void DiskManager::loadFreePages() {
+  fsm_fd_ = open(fsm_name_.c_str(), O_RDWR);
+  if (fsm_fd_ < 0) {
+    return;
+  }
+  off_t size = GetFileSize(fsm_fd_);
+  free_pages_.resize(std::max<off_t>(size, 0) / sizeof(uint64_t));
+  ssize_t read_count =
+      ReadFully(fsm_fd_, reinterpret_cast<char *>(free_pages_.data()),
+                free_pages_.size() * sizeof(uint64_t), 0);
+  if (read_count != static_cast<ssize_t>(free_pages_.size() * sizeof(uint64_t))) {
+    LOG_DEBUG("I/O error while reading free space map");
+    free_pages_.clear();
+  }
+  for (size_t i = 0; i < free_pages_.size(); i++) {
+    for (int bit = 0; bit < 64; bit++) {
+      if (static_cast<page_id_t>(i * 64 + bit) >= next_page_id_) {
+        free_pages_[i] &= ~(1ull << bit);
+      }
+    }
+    num_free_pages_ += __builtin_popcountll(free_pages_[i]);
+  }
+  for (size_t i = 0; i < free_pages_.size(); i++) {
+    persistFreePages(i);
+  }
+}
+
+/**
+ * Write one word of the bitmap to the .fsm file, if there is one yet.
+ * Called with alloc_latch_ held
+ */
+void DiskManager::persistFreePages(size_t word) {
+  if (fsm_fd_ < 0) {
+    return;
+  }
+  if (WriteFully(fsm_fd_, reinterpret_cast<const char *>(&free_pages_[word]),
+                 sizeof(uint64_t), word * sizeof(uint64_t)) !=
+      sizeof(uint64_t)) {
+    LOG_DEBUG("I/O error while writing free space map");
+  }
+}
+
+/**
+ * Pages beyond it were never written, reading them only gives zeros
+ */
+page_id_t DiskManager::GetNumPages() {
+  if (compress_) {
+    std::lock_guard<std::mutex> guard(map_latch_);
+    return page_map_.size();
+  }
+  off_t num_pages = std::max<off_t>(GetFileSize(db_fd_), 0) / page_size_;
+  return static_cast<page_id_t>(std::min<off_t>(
+      num_pages, std::numeric_limits<page_id_t>::max()));
 }
 
 /**
@@ -183,10 +1273,19 @@ bool DiskManager::GetFlushState() const { return flush_log_; }
 /**
  * Private helper function to get disk file size
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
+off_t DiskManager::GetFileSize(const std::string &file_name) {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
   return rc == 0 ? stat_buf.st_size : -1;
 }
 
+/**
+ * Size of a file that is open, without a path lookup
+ */
+off_t DiskManager::GetFileSize(int fd) {
+  struct stat stat_buf;
+  int rc = fd < 0 ? -1 : fstat(fd, &stat_buf);
+  return rc == 0 ? stat_buf.st_size : -1;
+}
+
 } // namespace cmudb
@@ -1,10 +1,35 @@
-#include <list>
+#include <list>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #include "hash/extendible_hash.h"
 #include "page/page.h"
 
 namespace cmudb {
 
+// fingerprints compared per instruction; bucket tag arrays are padded to it
+#if defined(__AVX2__)
+static const size_t TAG_GROUP = 32;
+#else
+static const size_t TAG_GROUP = 16;
+#endif
+
+/*
+ * one byte fingerprint of a key: the top bits of its mixed hash (the low bits
+ * of the plain hash pick the bucket), high bit set so it is never 0
+ */
+static inline uint8_t TagOf(size_t hash) {
+  uint64_t mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL;
+  return static_cast<uint8_t>((mixed >> 57) | 0x80);
+}
+
+template <typename K, typename V>
+ExtendibleHash<K, V>::Bucket::Bucket(int depth, size_t capacity)
+    : localDepth(depth), size(0),
+      tags((capacity + TAG_GROUP - 1) / TAG_GROUP * TAG_GROUP, 0),
+      keys(capacity), values(capacity) {}
+
 /*
  * constructor
  * array_size: fixed array size for each bucket
@@ -12,7 +37,7 @@ namespace cmudb {
 template <typename K, typename V>
 ExtendibleHash<K, V>::ExtendibleHash(size_t size)
     :globalDepth(0), bucketMaxSize(size), numBuckets(0) {
-    bucketTable.push_back(std::make_shared<Bucket>(0));
+    bucketTable.push_back(std::make_shared<Bucket>(0, bucketMaxSize));
 }
 
 /*
@@ -57,13 +82,14 @@ bool ExtendibleHash<K, V>::Find(const K &key, V &value) {
   //https://en.cppreference.com/w/cpp/thread/mutex
   std::lock_guard<std::mutex> guard(mutex);
 
-  auto index = getBucketIndex(key);
-  std::shared_ptr<Bucket> bucket = bucketTable[index];
-  if (bucket != nullptr && bucket->items.find(key) != bucket->items.end()) {
-    value = bucket->items[key];
-    return true;
-  }
-  return false;
+  size_t hash = HashKey(key);
+  const Bucket &bucket = *bucketTable[getBucketIndex(hash)];
+  int index = findInBucket(bucket, key, TagOf(hash));
+  if (index < 0) {
+    return false;
+  }
+  value = bucket.values[index];
+  return true;
 }
 
 /*
@@ -74,19 +100,72 @@ template <typename K, typename V>
 bool ExtendibleHash<K, V>::Remove(const K &key) {
   std::lock_guard<std::mutex> guard(mutex);
 
-  auto index = getBucketIndex(key);
-  std::shared_ptr<Bucket> bucket = bucketTable[index];
-
-  if (bucket == nullptr || bucket->items.find(key) == bucket->items.end()) {
+  size_t hash = HashKey(key);
+  Bucket &bucket = *bucketTable[getBucketIndex(hash)];
+  int index = findInBucket(bucket, key, TagOf(hash));
+  if (index < 0) {
     return false;
   }
-  bucket->items.erase(key);
-  return true;
+  // keep the items packed: the last one fills the hole
+  size_t last = bucket.size - 1;
+  if (static_cast<size_t>(index) != last) {
+    bucket.tags[index] = bucket.tags[last];
+    bucket.keys[index] = bucket.keys[last];
+    bucket.values[index] = bucket.values[last];
+  }
+  bucket.tags[last] = 0;
+  bucket.values[last] = V();
+  bucket.size--;
+  return true;
+}
+
+template <typename K, typename V>
+int ExtendibleHash<K, V>::getBucketIndex(size_t hash) const {
+    return hash & ((1 << globalDepth) - 1);
+}
+
+/*
+ * position of key in bucket, or -1. Compares the fingerprints of TAG_GROUP
+ * items at once, slots past the end have tag 0 and never match
+ */
+template <typename K, typename V>
+int ExtendibleHash<K, V>::findInBucket(const Bucket &bucket, const K &key,
+                                       uint8_t tag) const {
+  for (size_t group = 0; group < bucket.size; group += TAG_GROUP) {
+    const uint8_t *tags = &bucket.tags[group];
+#if defined(__AVX2__)
+    __m256i groupTags =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(tags));
+    uint32_t matches = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(groupTags, _mm256_set1_epi8(static_cast<char>(tag)))));
+#elif defined(__SSE2__)
+    __m128i groupTags = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tags));
+    uint32_t matches = static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(groupTags, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+    uint32_t matches = 0;
+    for (size_t i = 0; i < TAG_GROUP; i++) {
+      matches |= static_cast<uint32_t>(tags[i] == tag) << i;
+    }
+#endif
+    while (matches != 0) {
+      size_t index = group + __builtin_ctz(matches);
+      if (bucket.keys[index] == key) {
+        return static_cast<int>(index);
+      }
+      matches &= matches - 1;
+    }
+  }
+  return -1;
 }
 
 template <typename K, typename V>
-int ExtendibleHash<K, V>::getBucketIndex(const K &key) const {
-    return HashKey(key) & ((1 << globalDepth) - 1);
+void ExtendibleHash<K, V>::appendToBucket(Bucket &bucket, const K &key,
+                                          const V &value, uint8_t tag) {
+  bucket.tags[bucket.size] = tag;
+  bucket.keys[bucket.size] = key;
+  bucket.values[bucket.size] = value;
+  bucket.size++;
 }
 
 /*
@@ -98,10 +177,18 @@ template <typename K, typename V>
 void ExtendibleHash<K, V>::Insert(const K &key, const V &value) {
   std::lock_guard<std::mutex> guard(mutex);
 
-  auto index = getBucketIndex(key);
+  size_t hash = HashKey(key);
+  uint8_t tag = TagOf(hash);
+  auto index = getBucketIndex(hash);
   std::shared_ptr<Bucket> targetBucket = bucketTable[index];
 
-  while (targetBucket->items.size() == bucketMaxSize) {
+  int found = findInBucket(*targetBucket, key, tag);
+  if (found >= 0) {
+    targetBucket->values[found] = value;
+    return;
+  }
+
+  while (targetBucket->size == bucketMaxSize) {
     if (targetBucket->localDepth == globalDepth) {
       size_t length = bucketTable.size();
       for (size_t i = 0; i < length; i++) {
@@ -111,32 +198,42 @@ void ExtendibleHash<K, V>::Insert(const K &key, const V &value) {
     }
     int mask = 1 << targetBucket->localDepth;
 
-    auto zeroBucket = std::make_shared<Bucket>(targetBucket->localDepth + 1);
-    auto oneBucket = std::make_shared<Bucket>(targetBucket->localDepth + 1);
-    for (auto item : targetBucket->items) {
-      size_t hashkey = HashKey(item.first);
-      if (hashkey & mask) {
-        oneBucket->items.insert(item);
+    // split in place: items with the new bit set move to oneBucket in one
+    // pass, the others are packed to the front of targetBucket
+    auto oneBucket =
+        std::make_shared<Bucket>(targetBucket->localDepth + 1, bucketMaxSize);
+    targetBucket->localDepth++;
+    size_t kept = 0;
+    for (size_t i = 0; i < targetBucket->size; i++) {
+      if (HashKey(targetBucket->keys[i]) & mask) {
+        appendToBucket(*oneBucket, targetBucket->keys[i],
+                       targetBucket->values[i], targetBucket->tags[i]);
       } else {
-        zeroBucket->items.insert(item);
+        if (kept != i) {
+          targetBucket->tags[kept] = targetBucket->tags[i];
+          targetBucket->keys[kept] = targetBucket->keys[i];
+          targetBucket->values[kept] = targetBucket->values[i];
+        }
+        kept++;
       }
     }
+    for (size_t i = kept; i < targetBucket->size; i++) {
+      targetBucket->tags[i] = 0;
+      targetBucket->values[i] = V();
+    }
+    targetBucket->size = kept;
 
     for (size_t i = 0; i < bucketTable.size(); i++) {
-      if (bucketTable[i] == targetBucket) {
-        if (i & mask) {
-          bucketTable[i] = oneBucket;
-        } else {
-          bucketTable[i] = zeroBucket;
-        }
+      if (bucketTable[i] == targetBucket && (i & mask)) {
+        bucketTable[i] = oneBucket;
       }
     }
 
-    index = getBucketIndex(key);
+    index = getBucketIndex(hash);
     targetBucket = bucketTable[index];
   } //end while
 
-  targetBucket->items[key] = value;
+  appendToBucket(*targetBucket, key, value, tag);
 }
 
 template class ExtendibleHash<page_id_t, Page *>;
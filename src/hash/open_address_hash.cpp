@@ -0,0 +1,162 @@
+#include <cassert>
+#include <functional>
+
+#include "common/exception.h"
+#include "hash/open_address_hash.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+/*
+ * constructor
+ * the capacity is a power of two at least twice max_size, so probe chains
+ * stay short
+ */
+template <typename K, typename V>
+OpenAddressHash<K, V>::OpenAddressHash(size_t max_size) : max_size_(max_size) {
+  size_t capacity = 2;
+  while (capacity < 2 * max_size) {
+    capacity <<= 1;
+  }
+  slots_ = new Slot[capacity];
+  mask_ = capacity - 1;
+}
+
+template <typename K, typename V> OpenAddressHash<K, V>::~OpenAddressHash() {
+  delete[] slots_;
+}
+
+/*
+ * mix the bits of std::hash (the identity for integers, and page ids are
+ * dense) so that neighbouring keys do not form one long cluster
+ */
+template <typename K, typename V>
+size_t OpenAddressHash<K, V>::homeSlot(const K &key) const {
+  uint64_t hash = static_cast<uint64_t>(std::hash<K>()(key));
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return static_cast<size_t>(hash) & mask_;
+}
+
+/*
+ * lookup function to find value associate with input key, without any lock.
+ * A slot being written is read again until its version is stable
+ */
+template <typename K, typename V>
+bool OpenAddressHash<K, V>::Find(const K &key, V &value) {
+  size_t index = homeSlot(key);
+  for (size_t probes = 0; probes <= mask_; probes++) {
+    Slot &slot = slots_[index];
+    uint32_t version;
+    bool occupied;
+    K slotKey;
+    V slotValue;
+    do {
+      version = slot.version.load(std::memory_order_acquire);
+      occupied = slot.occupied.load(std::memory_order_relaxed);
+      slotKey = slot.key.load(std::memory_order_relaxed);
+      slotValue = slot.value.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((version & 1) ||
+             version != slot.version.load(std::memory_order_relaxed));
+
+    if (occupied && slotKey == key) {
+      value = slotValue;
+      return true;
+    }
+    if (slot.overflow.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+    index = (index + 1) & mask_;
+  }
+  return false;
+}
+
+/*
+ * delete <key,value> entry in hash table
+ * Shrink bucket? nothing to shrink, the slot becomes free and the overflow
+ * counts of the slots the key had probed past drop again
+ */
+template <typename K, typename V>
+bool OpenAddressHash<K, V>::Remove(const K &key) {
+  std::lock_guard<std::mutex> guard(write_latch_);
+
+  long found = findSlot(key);
+  if (found < 0) {
+    return false;
+  }
+  Slot &slot = slots_[found];
+  writeSlot(slot, false, slot.key.load(std::memory_order_relaxed),
+            slot.value.load(std::memory_order_relaxed));
+  for (size_t index = homeSlot(key); index != static_cast<size_t>(found);
+       index = (index + 1) & mask_) {
+    slots_[index].overflow.fetch_sub(1, std::memory_order_release);
+  }
+  size_--;
+  return true;
+}
+
+/*
+ * insert <key,value> entry in hash table, overwriting the value if key is
+ * already there. Throws if the table already holds max_size entries
+ */
+template <typename K, typename V>
+void OpenAddressHash<K, V>::Insert(const K &key, const V &value) {
+  std::lock_guard<std::mutex> guard(write_latch_);
+
+  long found = findSlot(key);
+  if (found >= 0) {
+    writeSlot(slots_[found], true, key, value);
+    return;
+  }
+  if (size_ == max_size_) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE, "hash table is full");
+  }
+  size_t index = homeSlot(key);
+  // a free slot always exists, at least half of the slots are free. Count
+  // the probe past every occupied slot before the key becomes visible
+  while (slots_[index].occupied.load(std::memory_order_relaxed)) {
+    slots_[index].overflow.fetch_add(1, std::memory_order_release);
+    index = (index + 1) & mask_;
+  }
+  writeSlot(slots_[index], true, key, value);
+  size_++;
+}
+
+/*
+ * same probe as Find(), the caller holds write_latch_ so no slot changes
+ */
+template <typename K, typename V>
+long OpenAddressHash<K, V>::findSlot(const K &key) const {
+  size_t index = homeSlot(key);
+  for (size_t probes = 0; probes <= mask_; probes++) {
+    const Slot &slot = slots_[index];
+    if (slot.occupied.load(std::memory_order_relaxed) &&
+        slot.key.load(std::memory_order_relaxed) == key) {
+      return static_cast<long>(index);
+    }
+    if (slot.overflow.load(std::memory_order_relaxed) == 0) {
+      return -1;
+    }
+    index = (index + 1) & mask_;
+  }
+  return -1;
+}
+
+template <typename K, typename V>
+void OpenAddressHash<K, V>::writeSlot(Slot &slot, bool occupied, const K &key,
+                                      const V &value) {
+  uint32_t version = slot.version.load(std::memory_order_relaxed);
+  slot.version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.occupied.store(occupied, std::memory_order_relaxed);
+  slot.key.store(key, std::memory_order_relaxed);
+  slot.value.store(value, std::memory_order_relaxed);
+  slot.version.store(version + 2, std::memory_order_release);
+}
+
+template class OpenAddressHash<page_id_t, Page *>;
+// test purpose
+template class OpenAddressHash<int, int>;
+} // namespace cmudb
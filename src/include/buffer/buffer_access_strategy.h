@@ -0,0 +1,42 @@
+/**
+ * buffer_access_strategy.h
+ *
+ * Functionality: access hint for FetchPage(). A large sequential scan passes a
+ * BufferAccessStrategy so that the pages it reads recycle through a small
+ * ring of frames (like the PostgreSQL bulk read strategy) instead of evicting
+ * everything else from the shared pool. Pages already in the pool are used as
+ * they are; only misses take a frame from the ring, and the ring only grows
+ * with a frame from the shared pool when none of its frames is reusable.
+ *
+ * A strategy belongs to one scan and is not thread safe. It must outlive the
+ * iterators it is passed to.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "common/config.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+class BufferAccessStrategy {
+  friend class BufferPoolManager;
+
+public:
+  explicit BufferAccessStrategy(size_t ring_size = BUFFER_RING_SIZE)
+      : ring_(ring_size, nullptr), ring_page_ids_(ring_size, INVALID_PAGE_ID) {}
+
+  inline size_t GetRingSize() const { return ring_.size(); }
+
+private:
+  // frames of the ring and the page each was last used for. A frame whose
+  // page changed has been taken over by someone else and is not reused
+  std::vector<Page *> ring_;
+  std::vector<page_id_t> ring_page_ids_;
+  // slot the last miss was served from
+  size_t current_ = 0;
+};
+
+} // namespace cmudb
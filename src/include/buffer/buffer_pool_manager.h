@@ -4,15 +4,42 @@
  * Functionality: The simplified Buffer Manager interface allows a client to
  * new/delete pages on disk, to read a disk page into the buffer pool and pin
  * it, also to unpin a page in the buffer pool.
+ *
+ * The pool can be split into several independent instances, each with its own
+ * page table, replacer, free list and latch. A page always lives in instance
+ * page_id % num_instances, so threads working on different pages do not
+ * contend on a single latch.
+ *
+ * A cache hit takes no latch at all: the page table is read lock free and the
+ * frame is pinned with a compare and swap on its pin count. A frame changes
+ * pages only under the instance latch, after its pin count went from 0 to -1,
+ * so a pinned frame never goes away. The replacer only holds hints, a frame
+ * pinned after it became a candidate is skipped when it comes up as victim.
+ *
+ * On a read only disk manager the pool has no frames: FetchPage() returns a
+ * view of the page in the mapping of the db file, nothing is copied or ever
+ * evicted. Views are made on first use and kept, the checksum of a page is
+ * verified the first time it is fetched. Pages can not be created, deleted
+ * or changed, and there are no hits or misses to count.
  */
 
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <list>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 
+#include "buffer/buffer_access_strategy.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
 #include "disk/disk_manager.h"
+#include "disk/extent.h"
 #include "hash/extendible_hash.h"
+#include "hash/open_address_hash.h"
 #include "logging/log_manager.h"
 #include "page/page.h"
 
@@ -20,17 +47,32 @@ namespace cmudb {
 class BufferPoolManager {
 public:
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager,
-                          LogManager *log_manager = nullptr);
+                          LogManager *log_manager = nullptr,
+                          size_t num_instances = 1,
+                          ReplacerType replacer_type = ReplacerType::LRU,
+                          bool use_huge_pages = false);
 
   ~BufferPoolManager();
 
-  Page *FetchPage(page_id_t page_id);
+  // with a strategy, a miss reuses a frame of the strategy's ring. Throws an
+  // Exception of type EXCEPTION_TYPE_IO if the page can not be read or fails
+  // its checksum
+  Page *FetchPage(page_id_t page_id, BufferAccessStrategy *strategy = nullptr);
 
   bool UnpinPage(page_id_t page_id, bool is_dirty);
 
   bool FlushPage(page_id_t page_id);
 
-  Page *NewPage(page_id_t &page_id);
+  // write every dirty page back, sorted by page id so that consecutive pages
+  // go out in one write, and sync the db file once (shutdown, checkpoints)
+  void FlushAllPages();
+
+  // page id -> recLSN of the pages whose changes may not all be on disk,
+  // without stopping anyone (fuzzy checkpoints)
+  void GetDirtyPageTable(std::unordered_map<page_id_t, lsn_t> &dirty_pages);
+
+  // with an extent, the page id comes from it
+  Page *NewPage(page_id_t &page_id, Extent *extent = nullptr);
 
   bool DeletePage(page_id_t page_id);
 
@@ -40,16 +82,136 @@ public:
 
   std::string ToString() const;
 
+  inline size_t GetNumInstances() const { return num_instances_; }
+
+  inline int GetPageSize() const { return disk_manager_->GetPageSize(); }
+
+  // frames live in explicitly reserved huge pages (MAP_HUGETLB), not only
+  // ones the kernel may give transparently
+  inline bool HasHugeTLBFrames() const { return huge_tlb_; }
+
+  // FetchPage() calls answered from memory / from disk
+  size_t GetNumHits();
+  size_t GetNumMisses();
+
+  // load pages in the background, without pinning them, so that a later
+  // FetchPage() finds them in the pool. Requests for pages already in the pool
+  // or beyond the end of the db file are dropped. A read only pool has the OS
+  // read them into the page cache
+  void Prefetch(page_id_t page_id);
+  void PrefetchRange(page_id_t page_id, int count);
+  // pages loaded by Prefetch()
+  inline size_t GetNumPrefetches() const { return num_prefetches_; }
+  // pages table and index scans started afterwards keep prefetched ahead of
+  // the page they are reading, 0 turns read ahead off
+  inline int GetReadAheadWindow() const { return read_ahead_window_; }
+  inline void SetReadAheadWindow(int window) { read_ahead_window_ = window; }
+
+  // spawn a separate thread that keeps num_free_frames clean frames (spread
+  // over the instances) on the free lists by writing back and evicting
+  // unpinned pages, so that misses do not have to write a dirty victim
+  void RunCleanerThread(size_t num_free_frames = CLEANER_FREE_FRAMES);
+  void StopCleanerThread();
+
+  // pages written back by FetchPage()/NewPage()/FlushPage() callers / by the
+  // cleaner thread
+  inline size_t GetNumForegroundWrites() const {
+    return num_foreground_writes_;
+  }
+  inline size_t GetNumBackgroundWrites() const {
+    return num_background_writes_;
+  }
+
 private:
-  size_t pool_size_; // number of pages in buffer pool
-  Page *pages_;      // array of pages
+  // one independent partition of the buffer pool
+  struct BufferPoolInstance {
+    size_t pool_size_; // number of pages in this instance
+    Page *pages_;      // slice of the shared page array
+    HashTable<page_id_t, Page *> *page_table_; // to keep track of pages
+    Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
+    std::list<Page *> *free_list_; // to find a free page for replacement
+    // to protect the free list and page table updates, and serialize frames
+    // changing pages. Not needed to pin a page already in the page table
+    std::mutex latch_;
+    std::atomic<size_t> num_hits_{0};
+    std::atomic<size_t> num_misses_{0};
+    // evicted dirty pages whose write back is still in flight, mapped to the
+    // frame that holds their content until the write completes. It has its
+    // own latch because the write back finishes without holding latch_
+    std::unordered_map<page_id_t, Page *> writing_back_;
+    std::mutex writing_back_latch_;
+  };
+
+  // views of MAPPED_CHUNK_PAGES pages of a read only database. checked_ is
+  // 0 until the checksum of a page is verified, then 1 if it passed and 2 if
+  // it did not
+  struct MappedChunk {
+    Page pages_[MAPPED_CHUNK_PAGES];
+    std::atomic<uint8_t> checked_[MAPPED_CHUNK_PAGES];
+  };
+
+  inline BufferPoolInstance &GetInstance(page_id_t page_id) {
+    return instances_[static_cast<size_t>(page_id) % num_instances_];
+  }
+
+  Page *findUnusedPage(BufferPoolInstance &instance, page_id_t &victim_page_id,
+                       BufferAccessStrategy *strategy = nullptr);
+  Page *findRingPage(BufferPoolInstance &instance,
+                     BufferAccessStrategy &strategy);
+  Page *claimVictim(BufferPoolInstance &instance);
+  void evictPage(BufferPoolInstance &instance, Page *page,
+                 page_id_t &victim_page_id);
+  bool pinPage(BufferPoolInstance &instance, Page *page, page_id_t page_id);
+  bool unpinFrame(BufferPoolInstance &instance, Page *page);
+  bool claimFrame(Page *page);
+  void finishIO(BufferPoolInstance &instance, Page *page,
+                page_id_t victim_page_id, bool read_page);
+  void writeBack(BufferPoolInstance &instance, Page *page,
+                 page_id_t victim_page_id);
+  void clearRecLSN(Page *page, lsn_t lsn);
+  void flushLog(lsn_t lsn);
+  void waitForIO(Page *page);
+  Page *checkRead(BufferPoolInstance &instance, Page *page, page_id_t page_id);
+  bool dropFailedRead(BufferPoolInstance &instance, Page *page);
+  page_id_t allocatePage(Extent *extent);
+  void runPrefetcher();
+  void prefetchPage(page_id_t page_id);
+  void runCleaner();
+  void cleanInstance(BufferPoolInstance &instance);
+  Page *findWritingBack(BufferPoolInstance &instance, page_id_t page_id);
+  Page *fetchMapped(page_id_t page_id);
+  Page *findMapped(page_id_t page_id);
+  MappedChunk *makeMappedChunk(size_t chunk_index);
+
+  size_t pool_size_;         // number of pages in buffer pool
+  Page *pages_ = nullptr;    // array of pages
+  // data of all frames, one mapping aligned for O_DIRECT I/O
+  char *frames_ = nullptr;
+  size_t frames_size_ = 0;
+  bool huge_tlb_ = false;
+  size_t num_instances_;
+  BufferPoolInstance *instances_ = nullptr;
+  // read only database, the pool holds views of num_mapped_pages_ pages
+  bool mapped_ = false;
+  size_t num_mapped_pages_ = 0;
+  std::atomic<MappedChunk *> *mapped_chunks_ = nullptr;
   DiskManager *disk_manager_;
   LogManager *log_manager_;
-  HashTable<page_id_t, Page *> *page_table_; // to keep track of pages
-  Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
-  std::list<Page *> *free_list_; // to find a free page for replacement
-  std::mutex latch_;             // to protect shared data structure
-
-  Page* findUnusedPage();
+  std::atomic<size_t> num_foreground_writes_{0};
+  std::atomic<size_t> num_background_writes_{0};
+  // prefetch thread, started by the first Prefetch()
+  std::thread *prefetch_thread_ = nullptr;
+  bool prefetch_running_ = false;
+  std::deque<page_id_t> prefetch_queue_;
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
+  std::atomic<size_t> num_prefetches_{0};
+  int read_ahead_window_ = READ_AHEAD_WINDOW;
+  // cleaner thread
+  std::thread *cleaner_thread_ = nullptr;
+  std::atomic<bool> cleaner_running_{false};
+  size_t cleaner_free_frames_ = 0; // per instance
+  std::mutex cleaner_latch_;
+  std::condition_variable cleaner_cv_;
 };
 } // namespace cmudb
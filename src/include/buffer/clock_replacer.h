@@ -0,0 +1,47 @@
+/**
+ * clock_replacer.h
+ *
+ * Functionality: CLOCK approximation of LRU. Every frame has a reference bit
+ * in a fixed array sized to the buffer pool, a clock hand sweeps the array and
+ * gives referenced frames a second chance. Insert/Erase/Victim never allocate.
+ *
+ * Values are mapped to frames by their distance from base, e.g. for Page *
+ * base is the first page of the pool, for integers it is 0.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class ClockReplacer : public Replacer<T> {
+public:
+  explicit ClockReplacer(size_t num_frames, const T &base = T());
+
+  ~ClockReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+private:
+  inline size_t frameOf(const T &value) const { return value - base_; }
+
+  size_t num_frames_;
+  T base_;
+  std::vector<char> in_replacer_; // frame can be evicted
+  std::vector<char> ref_bit_;     // frame was used since the hand last passed
+  size_t hand_ = 0;
+  size_t size_ = 0;
+  std::mutex mutex;
+};
+
+} // namespace cmudb
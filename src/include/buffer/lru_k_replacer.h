@@ -0,0 +1,61 @@
+/**
+ * lru_k_replacer.h
+ *
+ * Functionality: LRU-K replacement. For every frame the last K access times
+ * are kept, and the victim is the evictable frame whose K-th most recent
+ * access is furthest in the past (largest backward K-distance). Frames with
+ * fewer than K accesses have infinite distance and go first, least recently
+ * used among them. A sequential scan touches each page once, so it can not
+ * push out pages that are accessed repeatedly.
+ *
+ * Values are mapped to frames by their distance from base, the same way as
+ * ClockReplacer.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace cmudb {
+
+template <typename T> class LRUKReplacer : public Replacer<T> {
+public:
+  LRUKReplacer(size_t num_frames, size_t k = LRUK_REPLACER_K,
+               const T &base = T());
+
+  ~LRUKReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void RecordAccess(const T &value);
+
+  bool Remove(const T &value);
+
+private:
+  inline size_t frameOf(const T &value) const { return value - base_; }
+  void recordAccess(size_t frame);
+
+  size_t num_frames_;
+  size_t k_;
+  T base_;
+  // last k access timestamps of every frame, oldest first
+  std::vector<uint64_t> history_;
+  std::vector<size_t> history_size_;
+  std::vector<char> evictable_;
+  uint64_t current_timestamp_ = 0;
+  size_t size_ = 0;
+  std::mutex mutex;
+};
+
+} // namespace cmudb
@@ -0,0 +1,48 @@
+/**
+ * read_ahead_window.h
+ *
+ * Functionality: sequential read ahead for scans. Each time a scan reaches a
+ * page, it tells the window the id of the page that follows. The window keeps
+ * the next window_size page ids from there prefetched, only asking the buffer
+ * pool for ids not requested yet, and starts over when the scan jumps
+ * somewhere else. Page ids are assumed to grow along the scan, which holds for
+ * table heaps and indexes built by appending.
+ *
+ * Scans with a BufferAccessStrategy do not read ahead: prefetched pages land in
+ * the shared pool, not in the ring of the scan.
+ *
+ * A window belongs to one scan and is not thread safe.
+ */
+
+#pragma once
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class ReadAheadWindow {
+public:
+  explicit ReadAheadWindow(int window_size) : window_size_(window_size) {}
+
+  // next_page_id is the page the scan reads after the current one
+  inline void Advance(BufferPoolManager *bpm, page_id_t next_page_id) {
+    if (next_page_id == INVALID_PAGE_ID || window_size_ <= 0) {
+      return;
+    }
+    if (next_page_id < begin_ || next_page_id >= end_) {
+      begin_ = end_ = next_page_id;
+    }
+    if (next_page_id + window_size_ > end_) {
+      bpm->PrefetchRange(end_, next_page_id + window_size_ - end_);
+      end_ = next_page_id + window_size_;
+    }
+  }
+
+private:
+  int window_size_;
+  // page ids already handed to the buffer pool
+  page_id_t begin_ = INVALID_PAGE_ID;
+  page_id_t end_ = INVALID_PAGE_ID;
+};
+
+} // namespace cmudb
@@ -9,6 +9,9 @@
 
 namespace cmudb {
 
+// replacement policies BufferPoolManager can be built with
+enum class ReplacerType { LRU, CLOCK, LRUK };
+
 template <typename T> class Replacer {
 public:
   Replacer() {}
@@ -17,6 +20,10 @@ public:
   virtual bool Victim(T &value) = 0;
   virtual bool Erase(const T &value) = 0;
   virtual size_t Size() = 0;
+  // value was just accessed, only policies that keep history care
+  virtual void RecordAccess(const T &) {}
+  // value no longer holds the same page, forget it together with its history
+  virtual bool Remove(const T &value) { return Erase(value); }
 };
 
 } // namespace cmudb
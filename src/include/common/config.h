@@ -16,18 +16,41 @@ extern std::chrono::duration<long long int> LOG_TIMEOUT;
 
 extern std::atomic<bool> ENABLE_LOGGING;
 
+extern std::chrono::milliseconds CLEANER_TIMEOUT;
+
+extern std::chrono::milliseconds CHECKPOINT_INTERVAL;
+
 #define INVALID_PAGE_ID -1 // representing an invalid page id
 #define INVALID_TXN_ID -1  // representing an invalid txn id
 #define INVALID_LSN -1     // representing an invalid lsn
 #define HEADER_PAGE_ID 0   // the header page id
-#define PAGE_SIZE 512     // size of a data page in byte
+#define PAGE_SIZE 512     // default size of a data page in byte
+#define MIN_PAGE_SIZE 512 // page sizes a database can be created with,
+#define MAX_PAGE_SIZE 65536 // powers of two in between
+#define PAGE_CHECKSUM_SIZE 4 // CRC32C the disk manager keeps at the end of a page
 #define LOG_BUFFER_SIZE                                                            \
   ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // size of a log buffer in byte
 #define BUCKET_SIZE 50                 // size of extendible hash bucket
 #define BUFFER_POOL_SIZE 10            // size of buffer pool
+#define LRUK_REPLACER_K 2              // default K of LRU-K replacer
+#define BUFFER_RING_SIZE 4             // frames a sequential scan recycles
+#define CLEANER_FREE_FRAMES 2          // clean free frames the cleaner keeps
+#define READ_AHEAD_WINDOW 8            // pages a scan keeps prefetched ahead
+#define IO_QUEUE_DEPTH 64              // page I/Os in flight on an io_uring
+#define IO_THREADS 4                   // workers of the thread pool I/O backend
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024) // huge page size frames are rounded to
+#define EXTENT_SIZE 64                 // pages reserved at once for an object
+#define WRITE_BATCH_PAGES 256          // pages WritePages() writes at once
+#define COMPRESSED_SECTOR_SIZE 128     // unit compressed pages are stored in
+#define MAPPED_CHUNK_PAGES 1024        // page views a read only pool makes at once
+#define RECOVERY_THREADS 4             // workers redo replays the log with
+#define LOG_SEGMENT_SIZE (16 * 1024 * 1024) // size of a log segment file
+#define LOG_SPARE_SEGMENTS 4           // truncated segments kept for reuse
+#define LOG_RING_SIZE (2 * LOG_BUFFER_SIZE) // ring the log is appended into
+#define ACTIVE_TXN_SHARDS 16           // latches of the log's transaction table
 
 typedef int32_t page_id_t; // page id type
 typedef int32_t txn_id_t;  // transaction id type
-typedef int32_t lsn_t;     // log sequence number type
+typedef int64_t lsn_t;     // log sequence number type, a log offset
 
 } // namespace cmudb
\ No newline at end of file
@@ -0,0 +1,21 @@
+/**
+ * crc32c.h
+ *
+ * CRC-32C (Castagnoli), the checksum of pages on disk. Uses the SSE4.2 crc32
+ * instruction when the build targets it, a lookup table otherwise.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cmudb {
+
+// crc continues the checksum of data that came before
+uint32_t Crc32c(const char *data, size_t len, uint32_t crc = 0);
+
+// computed by the crc32 instruction
+bool Crc32cIsHardware();
+
+} // namespace cmudb
@@ -42,6 +42,7 @@ enum ExceptionType {
   EXCEPTION_TYPE_CONNECTION = 21,       // connection related
   EXCEPTION_TYPE_SYNTAX = 22,           // syntax related
   EXCEPTION_TYPE_BUFFER_ALL_PINNED = 23, //buffer page all pinned
+  EXCEPTION_TYPE_IO = 24,               // page I/O failed or page corrupted
 };
 
 class Exception : public std::runtime_error {
@@ -110,6 +111,8 @@ public:
       return "Syntax";
     case EXCEPTION_TYPE_BUFFER_ALL_PINNED:
         return "Page all pinned";
+    case EXCEPTION_TYPE_IO:
+      return "I/O";
     default:
       return "Unknown";
     }
@@ -0,0 +1,21 @@
+/**
+ * lz4.h
+ *
+ * Compression of pages in the LZ4 block format: a greedy compressor with a
+ * small hash table, and a decompressor that checks every length and offset
+ * against its buffers. Blocks are interchangeable with those of the
+ * reference implementation (LZ4_compress_default / LZ4_decompress_safe).
+ */
+
+#pragma once
+
+namespace cmudb {
+
+// compressed size, or 0 if the result does not fit into dst_capacity bytes
+int LZ4Compress(const char *src, int src_size, char *dst, int dst_capacity);
+
+// decompressed size, or -1 if src is not a valid block or its data does not
+// fit into dst_capacity bytes
+int LZ4Decompress(const char *src, int src_size, char *dst, int dst_capacity);
+
+} // namespace cmudb
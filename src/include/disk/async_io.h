@@ -0,0 +1,133 @@
+/**
+ * async_io.h
+ *
+ * Asynchronous positional reads and writes on raw file descriptors, used by
+ * DiskManager so that many page I/Os can be in flight at once.
+ *
+ * Two backends: IOUring submits requests to a Linux io_uring and reaps their
+ * completions on a separate thread, ThreadPoolIO runs pread()/pwrite() on a
+ * small pool of worker threads where io_uring is not available. Completion
+ * callbacks run on the backend's threads and must not block for long.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+// bytes transferred, or -errno if the request failed
+typedef std::function<void(ssize_t)> IOCallback;
+
+// pread()/pwrite() until len bytes are transferred, a read reaches the end of
+// the file, or an error occurs. Same result as an IOCallback gets
+ssize_t ReadFully(int fd, char *buf, size_t len, off_t offset);
+ssize_t WriteFully(int fd, const char *buf, size_t len, off_t offset);
+
+class AsyncIO {
+public:
+  virtual ~AsyncIO() {}
+
+  // io_uring if the kernel supports it and use_io_uring is set, the thread
+  // pool otherwise
+  static AsyncIO *Create(bool use_io_uring = true,
+                         size_t queue_depth = IO_QUEUE_DEPTH);
+
+  // buf has to stay valid until callback is called
+  virtual void Read(int fd, char *buf, size_t len, off_t offset,
+                    IOCallback callback) = 0;
+  virtual void Write(int fd, const char *buf, size_t len, off_t offset,
+                     IOCallback callback) = 0;
+
+  virtual const char *GetName() const = 0;
+};
+
+class ThreadPoolIO : public AsyncIO {
+public:
+  explicit ThreadPoolIO(size_t num_threads = IO_THREADS);
+  ~ThreadPoolIO();
+
+  void Read(int fd, char *buf, size_t len, off_t offset,
+            IOCallback callback) override;
+  void Write(int fd, const char *buf, size_t len, off_t offset,
+             IOCallback callback) override;
+
+  const char *GetName() const override { return "thread pool"; }
+
+private:
+  struct Request {
+    bool write;
+    int fd;
+    char *buf;
+    size_t len;
+    off_t offset;
+    IOCallback callback;
+  };
+
+  void submit(Request request);
+  void runWorker();
+
+  std::vector<std::thread> workers_;
+  std::deque<Request> requests_;
+  bool running_ = true;
+  std::mutex latch_;
+  std::condition_variable cv_;
+};
+
+class IOUring : public AsyncIO {
+public:
+  // throws if the ring can not be set up
+  explicit IOUring(size_t queue_depth = IO_QUEUE_DEPTH);
+  ~IOUring();
+
+  void Read(int fd, char *buf, size_t len, off_t offset,
+            IOCallback callback) override;
+  void Write(int fd, const char *buf, size_t len, off_t offset,
+             IOCallback callback) override;
+
+  const char *GetName() const override { return "io_uring"; }
+
+private:
+  struct Request {
+    struct iovec iov;
+    IOCallback callback;
+  };
+
+  void submit(int opcode, int fd, struct iovec iov, off_t offset,
+              IOCallback callback);
+  void runReaper();
+
+  int ring_fd_ = -1;
+  unsigned entries_ = 0;
+  // submission queue
+  void *sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  unsigned *sq_head_, *sq_tail_, *sq_mask_, *sq_array_;
+  void *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  // completion queue, may share its mapping with the submission queue
+  void *cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  unsigned *cq_head_, *cq_tail_, *cq_mask_;
+  void *cqes_;
+
+  // requests submitted and not reaped yet, bounded by entries_ so that the
+  // completion queue can not overflow
+  unsigned in_flight_ = 0;
+  std::mutex submit_latch_;
+  std::condition_variable submit_cv_;
+  std::thread *reaper_ = nullptr;
+};
+
+} // namespace cmudb
@@ -9,27 +9,148 @@
 
 #pragma once
 #include <atomic>
-#include <fstream>
+#include <cstdlib>
+#include <functional>
 #include <future>
+#include <map>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "disk/async_io.h"
 
 namespace cmudb {
 
 class DiskManager {
 public:
+  // how to open a database, set by name:
+  //   DiskManager::Options options;
+  //   options.direct_io = true;
+  //   DiskManager disk_manager("test.db", options);
+  struct Options {
+    // page I/O goes through io_uring if the kernel supports it, through a
+    // pread()/pwrite() thread pool otherwise
+    bool use_io_uring = true;
+    // open the db file with O_DIRECT, so pages are cached only in the buffer
+    // pool and not a second time in the OS page cache. Falls back to
+    // buffered I/O if the file system can not do direct I/O of whole pages
+    bool direct_io = false;
+    // only applies to a new database, an existing one is opened with the
+    // page size it was created with
+    int page_size = PAGE_SIZE;
+    // store the pages of a new database LZ4 compressed, packed into sectors
+    // of COMPRESSED_SECTOR_SIZE bytes wherever there is room in the db file.
+    // Where each page is, is kept in a page map next to the db file
+    // (<name>.map), its presence marks a compressed database. A rewritten
+    // page goes to a new place and the sectors it leaves are reused, the ones
+    // at the end of the file are given back by SyncDB(). Compressed
+    // databases do not use O_DIRECT
+    bool compress = false;
+    // open an existing database without changing any of its files and map
+    // the db file into memory, a buffer pool on top of it hands out pages
+    // straight from the mapping. Throws if the db file can not be opened or
+    // mapped, or is compressed
+    bool read_only = false;
+    // The log is kept in segment files of log_segment_size bytes,
+    // <name>.log.<segment number in hex>, the log offset (LSN) o is in
+    // segment o / log_segment_size. A new segment is written full of zeros
+    // and synced before it is used, so appends to it change no file system
+    // metadata. Only applies to a new log, an existing one keeps the size of
+    // its segments
+    int log_segment_size = LOG_SEGMENT_SIZE;
+  };
+
   DiskManager(const std::string &db_file);
+  DiskManager(const std::string &db_file, const Options &options);
   ~DiskManager();
 
+  // safe to call from many threads at once, on the same or different pages.
+  // The last PAGE_CHECKSUM_SIZE bytes of a page hold a CRC32C of its page id
+  // and the rest of it, stored by the writes and checked by the reads. It is
+  // a trailer so that the page layouts, which all start with their own
+  // header, are left as they are. ReadPage() returns false on I/O errors and
+  // on pages that fail the check, e.g. torn by a crash during their write,
+  // zeroed, or written to the offset of another page. Pages past the end of
+  // the file were never written, they read as zeros and pass
   void WritePage(page_id_t page_id, const char *page_data);
-  void ReadPage(page_id_t page_id, char *page_data);
+  bool ReadPage(page_id_t page_id, char *page_data);
+  // start the I/O and return at once, many can be in flight at the same time.
+  // The callback (on an I/O thread) or the future gets false on I/O errors,
+  // and on pages read that fail their checksum. page_data has to stay valid
+  // until then
+  void WritePageAsync(page_id_t page_id, const char *page_data,
+                      std::function<void(bool)> callback);
+  void ReadPageAsync(page_id_t page_id, char *page_data,
+                     std::function<void(bool)> callback);
+  std::future<bool> WritePageAsync(page_id_t page_id, const char *page_data);
+  std::future<bool> ReadPageAsync(page_id_t page_id, char *page_data);
+  inline const char *GetIOBackendName() const { return async_io_->GetName(); }
+  inline bool IsDirectIO() const { return direct_io_; }
+  inline bool IsCompressed() const { return compress_; }
+  inline bool IsReadOnly() const { return read_only_; }
+  // read only databases: the page in the mapping of the db file, nullptr past
+  // its end. The memory is read only, writing to it faults
+  inline char *GetMappedPage(page_id_t page_id) const {
+    size_t offset = static_cast<size_t>(page_id) * page_size_;
+    return page_id < 0 || offset >= mapping_size_ ? nullptr
+                                                  : mapping_ + offset;
+  }
+  // ask the OS to read count pages of the mapping ahead
+  void AdviseMappedPages(page_id_t page_id, int count);
+  // checks the checksum of a page that did not come from ReadPage()
+  bool VerifyPage(page_id_t page_id, const char *page_data) const;
+  // page bytes read from / written to the db file, as stored, i.e.
+  // compressed for a compressed database
+  inline size_t GetNumBytesRead() const { return bytes_read_; }
+  inline size_t GetNumBytesWritten() const { return bytes_written_; }
+  // size of every page of this database in byte
+  inline int GetPageSize() const { return page_size_; }
+  static bool IsValidPageSize(int page_size);
+  // write pages page_id, page_id + 1, ... with as few system calls as possible
+  void WritePages(page_id_t page_id, const std::vector<const char *> &pages);
+  // force written pages to stable storage
+  void SyncDB();
 
   void WriteLog(char *log_data, int size);
-  bool ReadLog(char *log_data, int size, int offset);
+  bool ReadLog(char *log_data, int size, lsn_t offset);
+  // where the next WriteLog() goes. Until recovery finds the end of the log,
+  // an existing log continues at the start of a new segment
+  inline lsn_t GetLogSize() const { return log_size_; }
+  // the log before this offset was discarded
+  inline lsn_t GetLogStart() const { return log_start_; }
+  inline int GetLogSegmentSize() const { return log_segment_size_; }
+  // recovery drops what follows the last complete log record
+  void TruncateLog(lsn_t size);
+  // give up the segments that lie wholly before offset. They go to the
+  // archive directory if one is set, otherwise up to LOG_SPARE_SEGMENTS of
+  // them are kept to become new segments later and the rest are removed
+  void DiscardLogBefore(lsn_t offset);
+  // has to be on the file system of the log, discarded segments are moved
+  inline void SetLogArchiveDirectory(const std::string &directory) {
+    std::lock_guard<std::mutex> guard(log_latch_);
+    archive_directory_ = directory;
+  }
+  // remove the log files of a database, spare segments included
+  static void RemoveLogFiles(const std::string &db_file);
 
+  // hands out deallocated pages before growing the file. Which pages are free
+  // is kept in a bitmap, persisted next to the db file (<name>.fsm)
   page_id_t AllocatePage();
   void DeallocatePage(page_id_t page_id);
+  // count consecutive new pages at the end of the file, returns the first
+  page_id_t AllocateExtent(int count);
+  // recovery redoes the creation of a page the file may not hold yet, it must
+  // not be handed out again
+  void MarkPageAllocated(page_id_t page_id);
+  // pages deallocated and not handed out again
+  size_t GetNumFreePages();
+  // number of pages the db file holds
+  page_id_t GetNumPages();
+  // pages from here on were never handed out. Read without a latch or a
+  // look at the file, e.g. to bound read ahead
+  inline page_id_t GetNextPageId() const { return next_page_id_; }
 
   int GetNumFlushes() const;
   bool GetFlushState() const;
@@ -37,14 +158,106 @@ public:
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
 private:
-  int GetFileSize(const std::string &name);
-  // stream to write log file
-  std::fstream log_io_;
+  off_t GetFileSize(const std::string &name);
+  off_t GetFileSize(int fd);
+  void openLog();
+  std::string segmentName(lsn_t segment) const;
+  bool switchLogSegment(lsn_t segment);
+  int createLogSegment(const std::string &name);
+  void releaseLogSegment(lsn_t segment);
+  int readPageSize(const std::string &db_file);
+  bool openDirect(const std::string &db_file);
+  void mapFile();
+  void loadFreePages();
+  void persistFreePages(size_t word);
+  uint32_t pageChecksum(page_id_t page_id, const char *page_data) const;
+  void stampChecksum(page_id_t page_id, char *page_data) const;
+  bool verifyChecksum(page_id_t page_id, const char *page_data) const;
+  int encodePage(page_id_t page_id, const char *page_data, char *stored) const;
+  bool decodePage(page_id_t page_id, const char *stored, int length,
+                  char *page_data) const;
+  // where a page of a compressed database is stored. length is 0 for a page
+  // never written, page_size_ for a page that did not compress
+  struct PageLocation {
+    uint32_t sector;
+    uint32_t length;
+  };
+  bool loadPageMap();
+  bool createPageMap();
+  PageLocation lookupPage(page_id_t page_id);
+  uint32_t reserveSectors(uint32_t count);
+  void finishWrite(page_id_t page_id, PageLocation location, bool ok);
+  // called with map_latch_ held
+  void placePage(page_id_t page_id, PageLocation location);
+  uint32_t allocateSectors(uint32_t count);
+  void freeSectors(uint32_t sector, uint32_t count);
+  inline uint32_t sectorsOf(uint32_t length) const {
+    return (length + sector_size_ - 1) / sector_size_;
+  }
+  // O_DIRECT I/O needs aligned buffers, others are read through a copy.
+  // Writes always go through one, see WritePage()
+  inline bool needsBounce(const char *data) const {
+    return direct_io_ &&
+           reinterpret_cast<uintptr_t>(data) % direct_io_align_ != 0;
+  }
+  inline char *allocateAligned() const {
+    return static_cast<char *>(aligned_alloc(direct_io_align_, page_size_));
+  }
+  // log records are appended at log_size_, into segment log_segment_ that
+  // log_fd_ is open on. Only the thread writing the log changes them, and
+  // only a checkpoint log_start_
+  int log_fd_;
+  lsn_t log_segment_;
+  std::atomic<lsn_t> log_size_;
+  std::atomic<lsn_t> log_start_;
+  int log_segment_size_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // guards the segment files, segment read_fd_ is open on for ReadLog() and
+  // the spare segments, named <name>.log.spare<segment they were>
+  std::mutex log_latch_;
+  int read_fd_;
+  lsn_t read_segment_;
+  std::vector<std::string> spare_segments_;
+  std::string archive_directory_;
   std::string file_name_;
+  // page I/O is positional, concurrent reads and writes need no latch
+  int db_fd_;
+  int page_size_;
+  bool direct_io_;
+  // buffer alignment O_DIRECT I/O needs
+  int direct_io_align_;
+  // whole pages of the db file mapped in read only mode
+  bool read_only_;
+  char *mapping_;
+  size_t mapping_size_;
+  AsyncIO *async_io_;
+  std::atomic<size_t> bytes_read_;
+  std::atomic<size_t> bytes_written_;
+  // compressed storage. page_map_ is indexed by page id, free_sectors_ maps
+  // the first sector of every free run before num_sectors_ to its length.
+  // Runs are merged when they meet, a run reaching num_sectors_ shrinks it.
+  // Sectors a page left behind are only freed once the map entry moving it
+  // away is synced, until then they wait in pending_free_sectors_ (first
+  // sector, length)
+  bool compress_;
+  uint32_t sector_size_;
+  std::string map_name_;
+  int map_fd_;
+  std::mutex map_latch_;
+  std::vector<PageLocation> page_map_;
+  std::map<uint32_t, uint32_t> free_sectors_;
+  std::vector<std::pair<uint32_t, uint32_t>> pending_free_sectors_;
+  uint32_t num_sectors_;
+  // page allocation. Bit i of free_pages_ is set if page i is free, words
+  // before free_hint_ have none. The .fsm file is created by the first
+  // DeallocatePage(), many databases never free a page
+  std::mutex alloc_latch_;
   std::atomic<page_id_t> next_page_id_;
+  std::vector<uint64_t> free_pages_;
+  size_t num_free_pages_;
+  size_t free_hint_;
+  std::string fsm_name_;
+  int fsm_fd_;
   int num_flushes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
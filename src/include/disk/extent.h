@@ -0,0 +1,48 @@
+/**
+ * extent.h
+ *
+ * Functionality: page allocation for one object (table heap, index). Pages are
+ * reserved from the disk manager extent_size consecutive pages at a time and
+ * handed out in order, so the pages of an object stay contiguous in the db
+ * file even when several objects grow at the same time, and a scan over them
+ * reads the file sequentially.
+ *
+ * Pages of an extent that are never handed out, e.g. because the object is
+ * dropped or the database restarts, are not reclaimed unless they are at the
+ * end of the file.
+ */
+
+#pragma once
+
+#include <mutex>
+
+#include "disk/disk_manager.h"
+
+namespace cmudb {
+
+class Extent {
+public:
+  // an extent_size of 1 allocates page by page, like without an extent
+  explicit Extent(int extent_size = EXTENT_SIZE) : extent_size_(extent_size) {}
+
+  inline page_id_t AllocatePage(DiskManager *disk_manager) {
+    if (extent_size_ <= 1) {
+      return disk_manager->AllocatePage();
+    }
+    std::lock_guard<std::mutex> guard(latch_);
+    if (next_ == end_) {
+      next_ = disk_manager->AllocateExtent(extent_size_);
+      end_ = next_ + extent_size_;
+    }
+    return next_++;
+  }
+
+private:
+  int extent_size_;
+  // pages of the current extent not handed out yet
+  page_id_t next_ = INVALID_PAGE_ID;
+  page_id_t end_ = INVALID_PAGE_ID;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
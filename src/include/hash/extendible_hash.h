@@ -9,10 +9,10 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 #include <vector>
 #include <string>
-#include <map>
 #include <memory>
 #include <mutex>
 
@@ -22,10 +22,17 @@ namespace cmudb {
 
 template <typename K, typename V>
 class ExtendibleHash : public HashTable<K, V> {
+    // items are kept packed in [0, size) of fixed capacity arrays. tags holds
+    // a one byte fingerprint of every item (0 from size on), so that a lookup
+    // compares a whole group of them with one SIMD instruction and only reads
+    // the keys whose fingerprint matches
     struct Bucket {
-            explicit Bucket(int depth):localDepth(depth) {};
+            Bucket(int depth, size_t capacity);
             int localDepth;
-            std::map<K, V> items;
+            size_t size;
+            std::vector<uint8_t> tags;
+            std::vector<K> keys;
+            std::vector<V> values;
     };
 
 public:
@@ -44,7 +51,10 @@ public:
 
 private:
   // add your own member variables here
-  int getBucketIndex(const K &key) const;
+  int getBucketIndex(size_t hash) const;
+  int findInBucket(const Bucket &bucket, const K &key, uint8_t tag) const;
+  void appendToBucket(Bucket &bucket, const K &key, const V &value,
+                      uint8_t tag);
   int globalDepth;
   size_t bucketMaxSize;
   int numBuckets;
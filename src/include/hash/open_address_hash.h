@@ -0,0 +1,64 @@
+/*
+ * open_address_hash.h : fixed capacity open addressing hash table whose
+ * lookups never block
+ *
+ * Functionality: page table of the buffer pool manager. Find() takes no lock,
+ * so a cache hit is resolved without serializing on anything. Insert() and
+ * Remove() are serialized by a writer latch.
+ *
+ * Every slot carries a version (a per slot seqlock: odd while a writer changes
+ * the slot) so that a reader never sees a key together with the value of
+ * another key, and an overflow count of the keys that probed past it (as in
+ * folly F14). A lookup stops at the first slot nobody probed past, so removed
+ * entries leave no tombstones behind and misses stay short.
+ *
+ * K and V must be trivially copyable. The table holds at most the capacity
+ * given to the constructor, it never grows.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "hash/hash_table.h"
+
+namespace cmudb {
+
+template <typename K, typename V>
+class OpenAddressHash : public HashTable<K, V> {
+  struct Slot {
+    std::atomic<uint32_t> version{0};
+    std::atomic<uint32_t> overflow{0}; // keys that probed past this slot
+    std::atomic<bool> occupied{false};
+    std::atomic<K> key{K()};
+    std::atomic<V> value{V()};
+  };
+
+public:
+  // room for at least max_size entries
+  explicit OpenAddressHash(size_t max_size);
+  ~OpenAddressHash();
+
+  // lookup and modifier
+  bool Find(const K &key, V &value) override;
+  bool Remove(const K &key) override;
+  void Insert(const K &key, const V &value) override;
+
+  size_t GetCapacity() const { return mask_ + 1; }
+
+private:
+  size_t homeSlot(const K &key) const;
+  // index of the slot holding key, or -1
+  long findSlot(const K &key) const;
+  void writeSlot(Slot &slot, bool occupied, const K &key, const V &value);
+
+  Slot *slots_;
+  size_t mask_;
+  size_t max_size_;
+  size_t size_ = 0;
+  std::mutex write_latch_;
+};
+
+} // namespace cmudb
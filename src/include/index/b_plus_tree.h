@@ -47,8 +47,10 @@ public:
                 Transaction *transaction = nullptr);
 
   // index iterator
-  INDEXITERATOR_TYPE Begin();
-  INDEXITERATOR_TYPE Begin(const KeyType &key);
+  // leaf pages of the scan are read through strategy, if given
+  INDEXITERATOR_TYPE Begin(BufferAccessStrategy *strategy = nullptr);
+  INDEXITERATOR_TYPE Begin(const KeyType &key,
+                           BufferAccessStrategy *strategy = nullptr);
 
   // Print this B+ tree to stdout using a simple command-line
   std::string ToString(bool verbose = false);
@@ -106,6 +108,8 @@ private:
   std::string index_name_;
   std::atomic<page_id_t> root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
+  // leaves come from here, so that a range scan reads the file sequentially
+  Extent leaf_extent_;
   KeyComparator comparator_;
   std::mutex root_id_mutex_;
 };
@@ -3,6 +3,7 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include "buffer/read_ahead_window.h"
 #include "page/b_plus_tree_leaf_page.h"
 
 namespace cmudb {
@@ -14,7 +15,8 @@ INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
 public:
   // you may define your own constructor based on your member variables
-  IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int index, BufferPoolManager *bpm);
+  IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int index, BufferPoolManager *bpm,
+                BufferAccessStrategy *strategy = nullptr);
   ~IndexIterator();
 
   bool isEnd() {
@@ -34,6 +36,9 @@ private:
   B_PLUS_TREE_LEAF_PAGE_TYPE *leaf_;
   int index_;
   BufferPoolManager *bmp_;
+  // leaf pages after the first are read through it, may be null
+  BufferAccessStrategy *strategy_;
+  ReadAheadWindow read_ahead_;
 };
 
 } // namespace cmudb
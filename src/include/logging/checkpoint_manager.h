@@ -0,0 +1,62 @@
+/**
+ * checkpoint_manager.h
+ * Fuzzy checkpoints, so that recovery does not read the whole log.
+ *
+ * A checkpoint appends a CHECKPOINT_BEGIN record, then CHECKPOINT_END
+ * records with the active transaction table as of the BEGIN record and the
+ * dirty page table (page -> recLSN) of the buffer pool. Once they are on
+ * disk, the LSN of the BEGIN record goes to the header page, where recovery
+ * starts its analysis. Transactions and page writes go on meanwhile.
+ * Pages still dirty since before the previous checkpoint are written first,
+ * so that redo never starts before it: with a checkpoint every interval,
+ * restart redoes at most the log of the last two intervals.
+ * The log segments recovery no longer needs are truncated after the
+ * checkpoint, see DiskManager::DiscardLogBefore().
+ */
+
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "buffer/buffer_pool_manager.h"
+#include "logging/log_manager.h"
+
+namespace cmudb {
+
+class CheckpointManager {
+public:
+  CheckpointManager(BufferPoolManager *buffer_pool_manager,
+                    LogManager *log_manager)
+      : buffer_pool_manager_(buffer_pool_manager), log_manager_(log_manager),
+        last_checkpoint_lsn_(INVALID_LSN), running_(false),
+        checkpoint_thread_(nullptr) {}
+
+  ~CheckpointManager() { StopCheckpointThread(); }
+
+  // take a checkpoint, return the LSN of its CHECKPOINT_BEGIN record. The
+  // header page has to be a formatted HeaderPage for recovery to find it
+  lsn_t Checkpoint();
+  inline lsn_t GetLastCheckpointLSN() { return last_checkpoint_lsn_; }
+
+  // spawn a separate thread taking a checkpoint every interval
+  void RunCheckpointThread(
+      std::chrono::milliseconds interval = CHECKPOINT_INTERVAL);
+  void StopCheckpointThread();
+
+private:
+  void runCheckpointThread(std::chrono::milliseconds interval);
+
+  BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
+  // one checkpoint at a time
+  std::mutex checkpoint_latch_;
+  std::atomic<lsn_t> last_checkpoint_lsn_;
+  // checkpoint thread
+  bool running_;
+  std::thread *checkpoint_thread_;
+  std::mutex thread_latch_;
+  std::condition_variable cv_;
+};
+
+} // namespace cmudb
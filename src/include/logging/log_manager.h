@@ -3,6 +3,15 @@
  * log manager maintain a separate thread that is awaken when the log buffer is
  * full or time out(every X second) to write log buffer's content into disk log
  * file.
+ * The log buffer is a ring, the record at LSN lsn goes to lsn % LOG_RING_SIZE.
+ * An append reserves its LSN (and so its place in the ring) with one
+ * compare-and-swap on next_lsn_, copies the record in without a latch and
+ * publishes it in completed_. The flush thread writes the records published
+ * so far that follow the written log without a gap, appends go on meanwhile.
+ * Records of every transaction that commits during a write go out together
+ * with the next one (group commit).
+ * The LSN of a record is its offset in the log, a new log manager continues
+ * where the disk manager appends.
  */
 
 #pragma once
@@ -10,6 +19,9 @@
 #include <condition_variable>
 #include <future>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "disk/disk_manager.h"
 #include "logging/log_record.h"
@@ -19,18 +31,25 @@ namespace cmudb {
 class LogManager {
 public:
   LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN),
-        disk_manager_(disk_manager) {
-    // TODO: you may intialize your own defined memeber variables here
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+      : next_lsn_(disk_manager->GetLogSize()),
+        persistent_lsn_(disk_manager->GetLogSize() - 1),
+        flush_requested_(false), flushing_(false), running_(false),
+        flush_thread_(nullptr), disk_manager_(disk_manager) {
+    // a record that runs past the end of the ring is copied in whole, its
+    // tail is moved to the front
+    log_buffer_ = new char[LOG_RING_SIZE + LOG_BUFFER_SIZE];
+    completed_ = new std::atomic<int32_t>[LOG_RING_SIZE];
+    for (int i = 0; i < LOG_RING_SIZE; i++) {
+      completed_[i] = 0;
+    }
   }
 
   ~LogManager() {
+    StopFlushThread();
     delete[] log_buffer_;
-    delete[] flush_buffer_;
+    delete[] completed_;
     log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
+    completed_ = nullptr;
   }
   // spawn a separate thread to wake up periodically to flush
   void RunFlushThread();
@@ -38,29 +57,66 @@ public:
 
   // append a log record into log buffer
   lsn_t AppendLogRecord(LogRecord &log_record);
+  // block until the records up to lsn are on disk, forcing a flush. Without
+  // the flush thread the caller writes the log buffer itself
+  void Flush(lsn_t lsn);
+  // append a CHECKPOINT_BEGIN record and return its LSN, with the
+  // transactions that have records but no COMMIT/ABORT yet, and the LSN of
+  // their last record, at that point of the log. oldest_lsn is the first
+  // record of the oldest of them, the BEGIN record if there are none
+  lsn_t BeginCheckpoint(std::vector<std::pair<txn_id_t, lsn_t>> &active_txns,
+                        lsn_t &oldest_lsn);
+  // give up the log before lsn, recovery never reads it again
+  inline void TruncateLog(lsn_t lsn) { disk_manager_->DiscardLogBefore(lsn); }
 
   // get/set helper functions
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
+  // recovery continues the LSNs of the log it found
+  inline void SetNextLSN(lsn_t lsn) { next_lsn_ = lsn; }
   inline char *GetLogBuffer() { return log_buffer_; }
 
 private:
-  // TODO: you may add your own member variables
-  // also remember to change constructor accordingly
+  // transactions without COMMIT/ABORT record -> LSN of their first and last
+  // record, split by transaction id
+  struct ActiveTxns {
+    std::mutex latch_;
+    std::unordered_map<txn_id_t, std::pair<lsn_t, lsn_t>> txns_;
+  };
 
-  // atomic counter, record the next log sequence number
+  void runFlushThread();
+  bool flushLogBuffer(std::unique_lock<std::mutex> &lock);
+  void waitForRoom(lsn_t end);
+  void trackTxn(const LogRecord &log_record);
+
+  // atomic counter, record the next log sequence number. Everything before
+  // it is reserved
   std::atomic<lsn_t> next_lsn_;
   // log records before & include persistent_lsn_ have been written to disk
   std::atomic<lsn_t> persistent_lsn_;
   // log buffer related
   char *log_buffer_;
-  char *flush_buffer_;
+  // at the ring position a record starts at: its size once it is copied in,
+  // 0 before and after it is written
+  std::atomic<int32_t> *completed_;
+  // appends waiting for room in the ring
+  std::mutex room_latch_;
+  ActiveTxns active_txns_[ACTIVE_TXN_SHARDS];
+  // a full buffer or a waiting commit wants the log written now
+  bool flush_requested_;
+  // records are being written
+  bool flushing_;
+  bool running_;
   // latch to protect shared member variables
   std::mutex latch_;
   // flush thread
   std::thread *flush_thread_;
   // for notifying flush thread
   std::condition_variable cv_;
+  // for appends waiting for room in the log buffer
+  std::condition_variable append_cv_;
+  // for threads waiting for persistent_lsn_ to move
+  std::condition_variable flushed_cv_;
   // disk manager
   DiskManager *disk_manager_;
 };
@@ -2,10 +2,17 @@
  * log_record.h
  * For every write opeartion on table page, you should write ahead a
  * corresponding log record.
- * For EACH log record, HEADER is like (5 fields in common, 20 bytes in totoal)
- *-------------------------------------------------------------
- * | size | LSN | transID | prevLSN | LogType |
- *-------------------------------------------------------------
+ * Integers are varints (7 bits a byte, low first, the high bit set on all
+ * but the last byte); ids and LSNs are stored plus one, so that the invalid
+ * ones (-1) take a byte. For EACH log record, HEADER is like
+ *------------------------------------------------------------------------------
+ * | crc32c (4) | length | LogType (1) | transID | prevLSN |
+ *------------------------------------------------------------------------------
+ * length counts the bytes after it. The LSN of a record is its offset in the
+ * log, it is not stored: the crc covers the LSN and the record after the crc,
+ * so a record checks out only where it was written. A torn last record, or an
+ * old one of a recycled segment, does not.
+ * A rid is | page_id | slot_num |.
  * For insert type log record
  *-------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
@@ -14,18 +21,41 @@
  *-------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
  *-------------------------------------------------------------
- * For update type log record
+ * For update type log record, either both images
  *------------------------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size |
+ * | HEADER | tuple_rid | 0 | tuple_size | old_tuple_data | tuple_size |
  * | new_tuple_data |
  *------------------------------------------------------------------------------
+ * or, when the tuple keeps its size, the ranges where the images differ, as
+ * the XOR of both (applied to either image it gives the other one)
+ *------------------------------------------------------------------------------
+ * | HEADER | tuple_rid | run_count * 2 + 1 | tuple_size |
+ * | (skip, length, xor_data) * run_count |
+ *------------------------------------------------------------------------------
+ * skip is the number of equal bytes before the run.
  * For new page type log record
  *-------------------------------------------------------------
- * | HEADER | prev_page_id |
+ * | HEADER | prev_page_id | page_id |
  *-------------------------------------------------------------
+ * For checkpoint end type log record (transID is INVALID_TXN_ID, prevLSN the
+ * LSN of the CHECKPOINT_BEGIN record)
+ *------------------------------------------------------------------------------
+ * | HEADER | txn_count | (txn_id, last_lsn) * txn_count | page_count |
+ * | (page_id, rec_lsn) * page_count |
+ *------------------------------------------------------------------------------
+ * A checkpoint with large tables writes several CHECKPOINT_END records.
+ * For compensation (CLR) type log record, written for a record undone by
+ * recovery: the change it makes, laid out like the body of that type
+ *------------------------------------------------------------------------------
+ * | HEADER | undo_next_lsn | change_type | change body |
+ *------------------------------------------------------------------------------
+ * undo_next_lsn is the prevLSN of the undone record, undo goes on there.
  */
 #pragma once
 #include <cassert>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "table/tuple.h"
@@ -44,6 +74,12 @@ enum class LogRecordType {
   ABORT,
   // when create a new page in heap table
   NEWPAGE,
+  // fuzzy checkpoint: the tables of the END record are those of the time
+  // the BEGIN record was appended
+  CHECKPOINT_BEGIN,
+  CHECKPOINT_END,
+  // redone like the change it holds, never undone
+  CLR,
 };
 
 class LogRecord {
@@ -57,8 +93,10 @@ public:
 
   // constructor for Transaction type(BEGIN/COMMIT/ABORT)
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type)
-      : size_(HEADER_SIZE), lsn_(INVALID_LSN), txn_id_(txn_id),
-        prev_lsn_(prev_lsn), log_record_type_(log_record_type) {}
+      : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type) {
+    size_ = encodedSize();
+  }
 
   // constructor for INSERT/DELETE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
@@ -76,7 +114,7 @@ public:
       delete_tuple_ = tuple;
     }
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
+    size_ = encodedSize();
   }
 
   // constructor for UPDATE type
@@ -86,23 +124,64 @@ public:
       : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
         log_record_type_(log_record_type), update_rid_(update_rid),
         old_tuple_(old_tuple), new_tuple_(new_tuple) {
+    if (old_tuple.GetLength() == new_tuple.GetLength()) {
+      diffUpdate();
+    }
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() +
-            new_tuple.GetLength() + 2 * sizeof(int32_t);
+    size_ = encodedSize();
   }
 
   // constructor for NEWPAGE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
-            page_id_t page_id)
-      : size_(HEADER_SIZE), lsn_(INVALID_LSN), txn_id_(txn_id),
-        prev_lsn_(prev_lsn), log_record_type_(log_record_type),
-        prev_page_id_(page_id) {
+            page_id_t prev_page_id, page_id_t page_id)
+      : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type), prev_page_id_(prev_page_id),
+        page_id_(page_id) {
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(page_id_t);
+    size_ = encodedSize();
+  }
+
+  // constructor for CLR type: the compensation of an undone record, making
+  // the change of action (built like any record of its type)
+  LogRecord(const LogRecord &action, lsn_t undo_next_lsn)
+      : LogRecord(action) {
+    assert(action.log_record_type_ != LogRecordType::CLR);
+    log_record_type_ = LogRecordType::CLR;
+    change_type_ = action.log_record_type_;
+    undo_next_lsn_ = undo_next_lsn;
+    size_ = encodedSize();
+  }
+
+  // constructor for CHECKPOINT_END type
+  LogRecord(lsn_t begin_lsn,
+            const std::vector<std::pair<txn_id_t, lsn_t>> &active_txns,
+            const std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages)
+      : lsn_(INVALID_LSN), txn_id_(INVALID_TXN_ID), prev_lsn_(begin_lsn),
+        log_record_type_(LogRecordType::CHECKPOINT_END),
+        active_txns_(active_txns), dirty_pages_(dirty_pages) {
+    size_ = encodedSize();
   }
 
   ~LogRecord() {}
 
+  // largest size of a CHECKPOINT_END record holding that many entries
+  static inline int CheckpointEndSize(size_t txn_count, size_t page_count) {
+    return static_cast<int>(MAX_HEADER_SIZE + 2 * MAX_VARINT32_SIZE +
+                            (txn_count + page_count) *
+                                (MAX_VARINT32_SIZE + MAX_VARINT64_SIZE));
+  }
+
+  // write the record, size_ bytes, once its LSN is set
+  void SerializeTo(char *data) const;
+  // read the record at data, written at lsn. false unless a whole record
+  // within available bytes checks out
+  bool DeserializeFrom(const char *data, int available, lsn_t lsn);
+
+  // an UPDATE record read from the log that holds the changed ranges only.
+  // Either image of the tuple turns into the other one
+  inline bool IsUpdateDelta() const { return update_delta_; }
+  Tuple ApplyUpdateDelta(const Tuple &image) const;
+
   inline RID &GetDeleteRID() { return delete_rid_; }
 
   inline Tuple &GetInserteTuple() { return insert_tuple_; }
@@ -111,6 +190,16 @@ public:
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline page_id_t GetNewPageId() { return page_id_; }
+
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxns() {
+    return active_txns_;
+  }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPages() {
+    return dirty_pages_;
+  }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -121,6 +210,14 @@ public:
 
   inline LogRecordType &GetLogRecordType() { return log_record_type_; }
 
+  // the type whose fields hold the change, that of the change for a CLR
+  inline LogRecordType GetChangeType() const {
+    return log_record_type_ == LogRecordType::CLR ? change_type_
+                                                  : log_record_type_;
+  }
+
+  inline lsn_t GetUndoNextLSN() { return undo_next_lsn_; }
+
   // For debug purpose
   inline std::string ToString() const {
     std::ostringstream os;
@@ -151,14 +248,39 @@ private:
   RID insert_rid_;
   Tuple insert_tuple_;
 
-  // case3: for update opeartion
+  // case3: for update opeartion. A delta is logged as the (offset, length)
+  // runs where the images differ. Read back, it sets update_xor_ (the XOR of
+  // both images) instead of the tuples
   RID update_rid_;
   Tuple old_tuple_;
   Tuple new_tuple_;
+  bool update_delta_ = false;
+  std::vector<std::pair<int32_t, int32_t>> update_runs_;
+  std::string update_xor_;
 
   // case4: for new page opeartion
   page_id_t prev_page_id_ = INVALID_PAGE_ID;
-  const static int HEADER_SIZE = 20;
+  page_id_t page_id_ = INVALID_PAGE_ID;
+
+  // case5: for checkpoint end
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
+
+  // case6: for compensation, the change is in the fields of its type
+  LogRecordType change_type_ = LogRecordType::INVALID;
+  lsn_t undo_next_lsn_ = INVALID_LSN;
+
+  // crc, length, type, transID and prevLSN at their largest
+  static const int MAX_VARINT32_SIZE = 5;
+  static const int MAX_VARINT64_SIZE = 10;
+  static const int MAX_HEADER_SIZE = sizeof(uint32_t) + MAX_VARINT32_SIZE + 1 +
+                                     MAX_VARINT32_SIZE + MAX_VARINT64_SIZE;
+
+  void diffUpdate();
+  int encodedSize() const;
+  // the fields after the length, only counted with data nullptr
+  int encodeFields(char *data) const;
+  bool decodeFields(const char *pos, const char *end);
 }; // namespace cmudb
 
 } // namespace cmudb
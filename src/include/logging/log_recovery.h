@@ -1,12 +1,22 @@
 /**
  * recovery_manager.h
  * Read log file from disk, redo and undo
+ *
+ * ARIES style: an analysis pass finds the transactions that did not finish
+ * and the pages the log changed, redo repeats history from the earliest
+ * change that may be missing on disk, and undo rolls the unfinished
+ * transactions back. Redo replays the records of a page in log order, but
+ * pages are spread over several workers.
+ * Analysis starts at the last checkpoint the header page records, with the
+ * tables its CHECKPOINT_END records hold. LSNs are log offsets, redo and
+ * undo read older records where they are.
  */
 
 #pragma once
 #include <algorithm>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
@@ -16,10 +26,16 @@ namespace cmudb {
 
 class LogRecovery {
 public:
+  // with a log manager, new records continue the LSNs of the recovered log,
+  // and what undo changes is logged in CLRs, so that a crash during recovery
+  // is recovered from as well, without undoing anything twice
   LogRecovery(DiskManager *disk_manager,
-                    BufferPoolManager *buffer_pool_manager)
+                    BufferPoolManager *buffer_pool_manager,
+                    LogManager *log_manager = nullptr,
+                    size_t num_redo_threads = RECOVERY_THREADS)
       : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager),
-        offset_(0) {
+        log_manager_(log_manager), num_redo_threads_(num_redo_threads),
+        log_end_(0), offset_(0), buffer_pos_(0) {
     // global transaction through recovery phase
     log_buffer_ = new char[LOG_BUFFER_SIZE];
   }
@@ -29,21 +45,39 @@ public:
     log_buffer_ = nullptr;
   }
 
+  // analysis, then redo. Has to run before logging is turned on
   void Redo();
   void Undo();
-  bool DeserializeLogRecord(const char *data, LogRecord &log_record);
+  bool DeserializeLogRecord(const char *data, lsn_t lsn,
+                            LogRecord &log_record);
 
 private:
-  // TODO: you can add whatever member variable here
-  // Don't forget to initialize newly added variable in constructor
+  struct RedoWorker;
+
+  lsn_t checkpointLSN();
+  void analyze();
+  void startScan(lsn_t offset);
+  bool nextLogRecord(LogRecord &log_record, lsn_t &offset);
+  static int getPages(const LogRecord &log_record, page_id_t *pages);
+  void redoRecord(const LogRecord &log_record, page_id_t page_id);
+  void runRedoWorker(RedoWorker *worker);
+  void undoRecord(LogRecord &log_record, lsn_t &prev_lsn);
+
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
+  size_t num_redo_threads_;
   // maintain active transactions and its corresponds latest lsn
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  // mapping log sequence number to log file offset, for undo purpose
-  std::unordered_map<lsn_t, int> lsn_mapping_;
-  // log buffer related
-  int offset_;
+  // pages the log changed, mapped to the first record that did (recLSN).
+  // Older records of a page need no redo
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table_;
+  // end of the last record that can be read, new records go there
+  lsn_t log_end_;
+  // log buffer related, holds the log from offset offset_ on, the next
+  // record is at buffer_pos_
+  lsn_t offset_;
+  int buffer_pos_;
   char *log_buffer_;
 };
 
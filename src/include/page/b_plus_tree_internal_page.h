@@ -31,7 +31,10 @@ INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
 public:
   // must call initialize method after "create" a new node
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID);
+  // page_size is the part of the page the node can use, see
+  // Page::GetContentSize()
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID,
+            int page_size = PAGE_SIZE - PAGE_CHECKSUM_SIZE);
 
   KeyType KeyAt(int index) const;
   void SetKeyAt(int index, const KeyType &key);
@@ -10,9 +10,9 @@
  * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
  *  ----------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ *  Header format (size in byte, 32 bytes in total):
  *  ---------------------------------------------------------------------
- * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
+ * | PageType (4) | LSN (8) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
  *  ----------------------------------------------------
  * | ParentPageId (4) | PageId (4) | NextPageId (4)
@@ -34,7 +34,10 @@ class BPlusTreeLeafPage : public BPlusTreePage {
 public:
   // After creating a new leaf page from buffer pool, must call initialize
   // method to set default values
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID);
+  // page_size is the part of the page the node can use, see
+  // Page::GetContentSize()
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID,
+            int page_size = PAGE_SIZE - PAGE_CHECKSUM_SIZE);
   // helper methods
   page_id_t GetNextPageId() const;
   void SetNextPageId(page_id_t next_page_id);
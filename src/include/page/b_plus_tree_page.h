@@ -6,9 +6,9 @@
  * It actually serves as a header part for each B+ tree page and
  * contains information shared by both leaf page and internal page.
  *
- * Header format (size in byte, 20 bytes in total):
+ * Header format (size in byte, 28 bytes in total):
  * ----------------------------------------------------------------------------
- * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
+ * | PageType (4) | LSN (8) | CurrentSize (4) | MaxSize (4) |
  * ----------------------------------------------------------------------------
  * | ParentPageId (4) | PageId(4) |
  * ----------------------------------------------------------------------------
@@ -36,7 +36,9 @@ enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
 
 enum class OperationType {GET = 0, INSERT, DELETE};
 
-// Abstract class.
+// Abstract class. Packed to 4 bytes, the LSN sits at offset 4 as on every
+// page
+#pragma pack(push, 4)
 class BPlusTreePage {
 public:
   bool IsLeafPage() const;
@@ -73,6 +75,7 @@ private:
   page_id_t parent_page_id_;
   page_id_t page_id_;
 };
+#pragma pack(pop)
 
 // only for test
 class IntComparator {
@@ -6,9 +6,15 @@
  * 32 bytes) and their corresponding root_id
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | RecordCount (4) | LSN (8) | Magic (4) | PageSize (4) | Entry_1 name (32) |
+ *  ---------------------------------------------------------------------
+ * | Entry_1 root_id (4) | ... |
+ *  ---------------------------
+ * LSN is where every page keeps it, here the LSN of the CHECKPOINT_BEGIN
+ * record of the last complete checkpoint. Magic and PageSize are
+ * written with the record count. They sit at a fixed offset so that the page
+ * size of a database can be read before it is known
  */
 
 #pragma once
@@ -17,11 +23,17 @@
 
 #include <cstring>
 
+#define HEADER_PAGE_MAGIC 0x15445db0 // marks a header page with a page size
+#define HEADER_PAGE_PREFIX_SIZE 20   // bytes before the first entry
+
 namespace cmudb {
 
 class HeaderPage : public Page {
 public:
   void Init() { SetRecordCount(0); }
+  // page size recorded in the first HEADER_PAGE_PREFIX_SIZE bytes of a header
+  // page, 0 if there is none
+  static int ReadPageSize(const char *data);
   /**
    * Record related
    */
@@ -33,6 +45,11 @@ public:
   bool GetRootId(const std::string &name, page_id_t &root_id);
   int GetRecordCount();
 
+  // where recovery starts reading the log. As the page LSN, the log is on
+  // disk up to it before the page is
+  inline lsn_t GetCheckpointLSN() { return GetLSN(); }
+  inline void SetCheckpointLSN(lsn_t lsn) { SetLSN(lsn); }
+
 private:
   /**
    * helper functions
@@ -8,8 +8,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <mutex>
 
 #include "common/config.h"
 #include "common/rwmutex.h"
@@ -20,10 +22,17 @@ class Page {
   friend class BufferPoolManager;
 
 public:
-  Page() { ResetMemory(); }
+  // data_ is set by the buffer pool manager to a frame of its page aligned
+  // region, which starts out zeroed
+  Page() {}
   ~Page(){};
   // get actual data page content
   inline char *GetData() { return data_; }
+  // size of the data in byte, the page size of the database
+  inline int GetPageSize() { return page_size_; }
+  // bytes the page content can use, the disk manager keeps a checksum in the
+  // rest
+  inline int GetContentSize() { return page_size_ - PAGE_CHECKSUM_SIZE; }
   // get page id
   inline page_id_t GetPageId() { return page_id_; }
   // get page pin count
@@ -34,18 +43,43 @@ public:
   inline void RUnlatch() { rwlatch_.RUnlock(); }
   inline void RLatch() { rwlatch_.RLock(); }
 
-  inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + 4); }
-  inline void SetLSN(lsn_t lsn) { memcpy(GetData() + 4, &lsn, 4); }
+  inline lsn_t GetLSN() {
+    lsn_t lsn;
+    memcpy(&lsn, GetData() + 4, sizeof(lsn_t));
+    return lsn;
+  }
+  // the first change since the page was last written becomes its recLSN.
+  // Changes are logged and set their LSN holding the page latch
+  inline void SetLSN(lsn_t lsn) {
+    memcpy(GetData() + 4, &lsn, sizeof(lsn_t));
+    lsn_t clean = INVALID_LSN;
+    rec_lsn_.compare_exchange_strong(clean, lsn);
+  }
 
 private:
   // method used by buffer pool manager
-  inline void ResetMemory() { memset(data_, 0, PAGE_SIZE); }
+  inline void ResetMemory() {
+    memset(data_, 0, page_size_);
+    rec_lsn_ = INVALID_LSN;
+  }
   // members
-  char data_[PAGE_SIZE]; // actual data
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  int pin_count_ = 0;
-  bool is_dirty_ = false;
+  char *data_ = nullptr; // actual data, page size aligned
+  int page_size_ = PAGE_SIZE;
+  // the buffer pool pins a cached page without its latch, so these are atomic.
+  // pin_count_ is -1 while the frame is being given to another page
+  std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
+  std::atomic<int> pin_count_{0};
+  std::atomic<bool> is_dirty_{false};
+  // LSN of the oldest change that may not be on disk, INVALID_LSN if none.
+  // Checkpoints collect it into the dirty page table
+  std::atomic<lsn_t> rec_lsn_{INVALID_LSN};
   RWMutex rwlatch_;
+  // set while buffer pool manager reads/writes this frame outside its latch,
+  // io_latch_ is held for the whole I/O so that others can wait on it
+  std::atomic<bool> io_pending_{false};
+  std::mutex io_latch_;
+  // set when the read of the page failed, until the frame is given up
+  std::atomic<bool> io_error_{false};
 };
 
 } // namespace cmudb
@@ -10,7 +10,7 @@
  *
  *  Header format (size in byte):
  *  --------------------------------------------------------------------------
- * | PageId (4)| LSN (4)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
+ * | PageId (4)| LSN (8)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
  *  --------------------------------------------------------------------------
  *  --------------------------------------------------------------
  * | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
@@ -65,6 +65,10 @@ public:
   bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
                 LockManager *lock_manager);
 
+  // recovery time, puts the tuple into the slot of rid, which has to be empty
+  // or the next new one
+  bool InsertTupleAt(const Tuple &tuple, const RID &rid);
+
   /**
    * Tuple iterator
    */
@@ -24,9 +24,11 @@ public:
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
             LogManager *log_manager, page_id_t first_page_id);
 
-  // create table heap
+  // create table heap. Its pages are allocated extent_size at a time, so that
+  // they stay contiguous on disk
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
-            LogManager *log_manager, Transaction *txn);
+            LogManager *log_manager, Transaction *txn,
+            int extent_size = EXTENT_SIZE);
 
   // for insert, if tuple is too large (>~page_size), return false
   bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn);
@@ -42,11 +44,14 @@ public:
                    Transaction *txn); // when commit delete or rollback insert
   void RollbackDelete(const RID &rid, Transaction *txn); // when rollback delete
 
-  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn);
+  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                BufferAccessStrategy *strategy = nullptr);
 
   bool DeleteTableHeap();
 
-  TableIterator begin(Transaction *txn);
+  // pages of the scan are read through strategy, if given
+  TableIterator begin(Transaction *txn,
+                      BufferAccessStrategy *strategy = nullptr);
 
   TableIterator end();
 
@@ -60,6 +65,7 @@ private:
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_;
+  Extent extent_;
 };
 
 } // namespace cmudb
@@ -8,6 +8,8 @@
 
 #include <cassert>
 
+#include "buffer/buffer_access_strategy.h"
+#include "buffer/read_ahead_window.h"
 #include "common/rid.h"
 #include "table/tuple.h"
 
@@ -19,7 +21,8 @@ class TableIterator {
   friend class Cursor;
 
 public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                BufferAccessStrategy *strategy = nullptr);
 
   ~TableIterator() { delete tuple_; }
 
@@ -43,6 +46,8 @@ private:
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  BufferAccessStrategy *strategy_;
+  ReadAheadWindow read_ahead_;
 };
 
 } // namespace cmudb
\ No newline at end of file
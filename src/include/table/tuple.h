@@ -49,6 +49,8 @@ public:
 
   // deserialize tuple data(deep copy)
   void DeserializeFrom(const char *storage);
+  // size bytes of tuple data without the size in front (deep copy)
+  void DeserializeFrom(const char *data, int32_t size);
 
   // return RID of current tuple
   inline RID GetRid() const { return rid_; }
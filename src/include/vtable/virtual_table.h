@@ -8,6 +8,7 @@
 #include "catalog/schema.h"
 #include "concurrency/transaction_manager.h"
 #include "index/b_plus_tree_index.h"
+#include "logging/checkpoint_manager.h"
 #include "logging/log_manager.h"
 #include "sqlite/sqlite3ext.h"
 #include "table/table_heap.h"
@@ -77,13 +78,18 @@ public:
     // txn related
     lock_manager_ = new LockManager(true); // S2PL
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
+
+    // checkpoint related
+    checkpoint_manager_ =
+        new CheckpointManager(buffer_pool_manager_, log_manager_);
   }
 
   ~StorageEngine() {
+    delete checkpoint_manager_;
     if (ENABLE_LOGGING)
       log_manager_->StopFlushThread();
-    delete disk_manager_;
     delete buffer_pool_manager_;
+    delete disk_manager_;
     delete log_manager_;
     delete lock_manager_;
     delete transaction_manager_;
@@ -94,6 +100,7 @@ public:
   LockManager *lock_manager_;
   TransactionManager *transaction_manager_;
   LogManager *log_manager_;
+  CheckpointManager *checkpoint_manager_;
 };
 
 StorageEngine *storage_engine_;
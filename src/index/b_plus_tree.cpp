@@ -1,6 +1,7 @@
 /**
  * b_plus_tree.cpp
  */
+#include <fstream>
 #include <iostream>
 #include <string>
 
@@ -96,13 +97,13 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value, Transaction *transaction) {
     page_id_t new_page_id;
-    Page *root_page = buffer_pool_manager_->NewPage(new_page_id);
+    Page *root_page = buffer_pool_manager_->NewPage(new_page_id, &leaf_extent_);
     if (root_page == nullptr) {
         throw BufferPoolManagerException(EXCEPTION_INFO);
     }
     //LOG_DEBUG("start new tree with root page id=%d\n", new_page_id);
     B_PLUS_TREE_LEAF_PAGE_TYPE *root = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(root_page->GetData());
-    root->Init(new_page_id, INVALID_PAGE_ID);
+    root->Init(new_page_id, INVALID_PAGE_ID, root_page->GetContentSize());
     buffer_pool_manager_->UnpinPage(new_page_id, false);
 
     // HeaderPageļĵһҳ¼<, root_page_id>
@@ -164,13 +165,15 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N> N *BPLUSTREE_TYPE::Split(N *node) {
     page_id_t new_page_id;
-    Page *new_page = buffer_pool_manager_->NewPage(new_page_id);
+    Page *new_page = buffer_pool_manager_->NewPage(
+        new_page_id, node->IsLeafPage() ? &leaf_extent_ : nullptr);
     if (new_page == nullptr) {
         throw BufferPoolManagerException(EXCEPTION_INFO);
     }
 
     N *new_node = reinterpret_cast<N *>(new_page->GetData());
-    new_node->Init(new_page_id, node->GetParentPageId());
+    new_node->Init(new_page_id, node->GetParentPageId(),
+                   new_page->GetContentSize());
     node->MoveHalfTo(new_node, buffer_pool_manager_);
     return new_node;
 }
@@ -199,7 +202,7 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
             throw BufferPoolManagerException(EXCEPTION_INFO);
         }
         BPInternalPage *new_root = reinterpret_cast<BPInternalPage *>(new_page->GetData());
-        new_root->Init(new_page_id);
+        new_root->Init(new_page_id, INVALID_PAGE_ID, new_page->GetContentSize());
         new_root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
 
         // άparentָ
@@ -473,10 +476,10 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node, Transaction *trans
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(BufferAccessStrategy *strategy) {
     KeyType invalidKey;
     auto start_leaf = FindLeafPage(invalidKey, OperationType::GET, nullptr, true);
-    return INDEXITERATOR_TYPE(start_leaf, 0, buffer_pool_manager_);
+    return INDEXITERATOR_TYPE(start_leaf, 0, buffer_pool_manager_, strategy);
 }
 
 /*
@@ -485,7 +488,8 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key,
+                                         BufferAccessStrategy *strategy) {
     auto start_leaf = FindLeafPage(key, OperationType::GET);
     int start_index = 0;
     if (start_leaf != nullptr) {
@@ -499,7 +503,8 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
             start_index = start_leaf->GetSize();
         }
     }
-    return INDEXITERATOR_TYPE(start_leaf, start_index, buffer_pool_manager_);
+    return INDEXITERATOR_TYPE(start_leaf, start_index, buffer_pool_manager_,
+                              strategy);
 }
 
 /*****************************************************************************
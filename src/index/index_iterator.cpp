@@ -12,8 +12,14 @@ namespace cmudb {
  * set your own input parameters
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int index, BufferPoolManager *bmp)
-    :leaf_(leaf), index_(index), bmp_(bmp) {}
+INDEXITERATOR_TYPE::IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int index, BufferPoolManager *bmp,
+                                  BufferAccessStrategy *strategy)
+    :leaf_(leaf), index_(index), bmp_(bmp), strategy_(strategy),
+     read_ahead_(strategy == nullptr ? bmp->GetReadAheadWindow() : 0) {
+    if (leaf_ != nullptr) {
+        read_ahead_.Advance(bmp_, leaf_->GetNextPageId());
+    }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::~IndexIterator() {
@@ -39,7 +45,7 @@ INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
             leaf_ = nullptr;
         } else {
             //leafָnext_page_idӦҶӽڵ
-            Page *next_page = bmp_->FetchPage(next_page_id);
+            Page *next_page = bmp_->FetchPage(next_page_id, strategy_);
             next_page->RLatch();
 
             Page *page = bmp_->FetchPage(leaf_->GetPageId());
@@ -49,6 +55,7 @@ INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
 
             leaf_ = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(next_page->GetData());
             index_ = 0;
+            read_ahead_.Advance(bmp_, leaf_->GetNextPageId());
         }
     }
     return *this;
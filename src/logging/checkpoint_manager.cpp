@@ -0,0 +1,126 @@
+/**
+ * checkpoint_manager.cpp
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "logging/checkpoint_manager.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+/*
+ * The active transactions are those of the BEGIN record. The dirty page
+ * table is collected after it, a page changed before the BEGIN record is
+ * in it unless it was written meanwhile, one changed later is found by the
+ * analysis reading on from the BEGIN record.
+ * Once the header page points to the checkpoint, recovery reads nothing
+ * before the BEGIN record, the recLSNs of the table (redo) and the first
+ * records of the active transactions (undo), the log before them goes
+ */
+lsn_t CheckpointManager::Checkpoint() {
+  std::lock_guard<std::mutex> guard(checkpoint_latch_);
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  lsn_t oldest_lsn;
+  lsn_t begin_lsn = log_manager_->BeginCheckpoint(active_txns, oldest_lsn);
+
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table;
+  buffer_pool_manager_->GetDirtyPageTable(dirty_page_table);
+  bool written = false;
+  for (auto &page : dirty_page_table) {
+    if (page.second < last_checkpoint_lsn_) {
+      written |= buffer_pool_manager_->FlushPage(page.first);
+    }
+  }
+  if (written) {
+    buffer_pool_manager_->GetDirtyPageTable(dirty_page_table);
+  }
+
+  // a record has to fit into the log buffer, large tables are split over
+  // several END records
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages(
+      dirty_page_table.begin(), dirty_page_table.end());
+  for (auto &page : dirty_pages) {
+    oldest_lsn = std::min(oldest_lsn, page.second);
+  }
+  size_t max_entries =
+      (LOG_BUFFER_SIZE - LogRecord::CheckpointEndSize(0, 0)) /
+      (LogRecord::CheckpointEndSize(1, 0) - LogRecord::CheckpointEndSize(0, 0));
+  size_t txn_pos = 0, page_pos = 0;
+  lsn_t end_lsn;
+  do {
+    size_t txn_count = std::min(max_entries, active_txns.size() - txn_pos);
+    size_t page_count =
+        std::min(max_entries - txn_count, dirty_pages.size() - page_pos);
+    LogRecord log_record(
+        begin_lsn,
+        std::vector<std::pair<txn_id_t, lsn_t>>(
+            active_txns.begin() + txn_pos,
+            active_txns.begin() + txn_pos + txn_count),
+        std::vector<std::pair<page_id_t, lsn_t>>(
+            dirty_pages.begin() + page_pos,
+            dirty_pages.begin() + page_pos + page_count));
+    end_lsn = log_manager_->AppendLogRecord(log_record);
+    txn_pos += txn_count;
+    page_pos += page_count;
+  } while (txn_pos < active_txns.size() || page_pos < dirty_pages.size());
+  log_manager_->Flush(end_lsn);
+
+  auto header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  bool is_header_page = HeaderPage::ReadPageSize(header_page->GetData()) != 0;
+  if (is_header_page) {
+    header_page->WLatch();
+    header_page->SetCheckpointLSN(begin_lsn);
+    header_page->WUnlatch();
+    // written while still pinned, so it is on disk before the log goes
+    buffer_pool_manager_->FlushPage(HEADER_PAGE_ID);
+  }
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  if (is_header_page) {
+    log_manager_->TruncateLog(oldest_lsn);
+  }
+  last_checkpoint_lsn_ = begin_lsn;
+  return begin_lsn;
+}
+
+void CheckpointManager::RunCheckpointThread(
+    std::chrono::milliseconds interval) {
+  std::lock_guard<std::mutex> guard(thread_latch_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  checkpoint_thread_ = new std::thread(
+      &CheckpointManager::runCheckpointThread, this, interval);
+}
+
+void CheckpointManager::StopCheckpointThread() {
+  {
+    std::lock_guard<std::mutex> guard(thread_latch_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  cv_.notify_one();
+  checkpoint_thread_->join();
+  delete checkpoint_thread_;
+  checkpoint_thread_ = nullptr;
+}
+
+void CheckpointManager::runCheckpointThread(
+    std::chrono::milliseconds interval) {
+  std::unique_lock<std::mutex> lock(thread_latch_);
+  while (running_) {
+    if (cv_.wait_for(lock, interval, [this] { return !running_; })) {
+      return;
+    }
+    lock.unlock();
+    Checkpoint();
+    lock.lock();
+  }
+}
+
+} // namespace cmudb
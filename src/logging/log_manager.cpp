@@ -3,8 +3,10 @@
  */
 
 #include "logging/log_manager.h"
+#include "common/exception.h"
 
 namespace cmudb {
+
 /*
  * set ENABLE_LOGGING = true
  * Start a separate thread to execute flush to disk operation periodically
@@ -12,35 +14,236 @@ namespace cmudb {
  * manager wants to force flush (it only happens when the flushed page has a
  * larger LSN than persistent LSN)
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  ENABLE_LOGGING = true;
+  flush_thread_ = new std::thread(&LogManager::runFlushThread, this);
+}
+
 /*
  * Stop and join the flush thread, set ENABLE_LOGGING = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  cv_.notify_one();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+  ENABLE_LOGGING = false;
+}
+
+/*
+ * write the log buffer when asked to, or every LOG_TIMEOUT. What is left in
+ * the buffer is written before the thread stops
+ */
+void LogManager::runFlushThread() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (running_) {
+    cv_.wait_for(lock, LOG_TIMEOUT,
+                 [this] { return flush_requested_ || !running_; });
+    if (!flushLogBuffer(lock) && flush_requested_) {
+      // the records asked for are still being copied in
+      lock.unlock();
+      std::this_thread::yield();
+      lock.lock();
+    }
+  }
+  while (flushLogBuffer(lock)) {
+  }
+  // nobody is left to write what waiters wait for
+  flushed_cv_.notify_all();
+  append_cv_.notify_all();
+}
+
+/*
+ * Called with latch_ held, by the flush thread, or by appends and Flush()
+ * when it does not run. Collect the records published after the written log
+ * up to the first one still being copied in, and write them without the
+ * latch. false if there were none
+ */
+bool LogManager::flushLogBuffer(std::unique_lock<std::mutex> &lock) {
+  while (flushing_) {
+    flushed_cv_.wait(lock);
+  }
+  lsn_t start = persistent_lsn_ + 1;
+  lsn_t end = start;
+  lsn_t reserved = next_lsn_;
+  while (end < reserved) {
+    int32_t size = completed_[end % LOG_RING_SIZE].exchange(
+        0, std::memory_order_acquire);
+    if (size == 0) {
+      break;
+    }
+    end += size;
+  }
+  if (end == start) {
+    if (reserved == start) {
+      // everything reserved is on disk, nothing to ask for
+      flush_requested_ = false;
+    }
+    return false;
+  }
+  flush_requested_ = false;
+  flushing_ = true;
+  lock.unlock();
+
+  int pos = static_cast<int>(start % LOG_RING_SIZE);
+  int size = static_cast<int>(end - start);
+  int first = std::min(size, LOG_RING_SIZE - pos);
+  disk_manager_->WriteLog(log_buffer_ + pos, first);
+  disk_manager_->WriteLog(log_buffer_, size - first);
+
+  lock.lock();
+  persistent_lsn_ = end - 1;
+  flushing_ = false;
+  flushed_cv_.notify_all();
+  append_cv_.notify_all();
+  return true;
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
  *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
+ * The record is laid out as described in log_record.h. Its size does not
+ * depend on its LSN, so the LSN and the room in the buffer are reserved at
+ * once, and records are copied in in parallel. If the ring has no room for
+ * the record yet, the append waits for the flush thread to write what is
+ * before it (without the thread, the append writes the buffer)
  */
 lsn_t LogManager::AppendLogRecord(LogRecord &log_record) {
+  int size = log_record.size_;
+  if (size > LOG_BUFFER_SIZE) {
+    throw Exception(EXCEPTION_TYPE_OBJECT_SIZE,
+                    "log record larger than the log buffer");
+  }
+  // a record is only reserved with room for it. Waiting for room while
+  // holding a reservation would hold up the records after it. The room is
+  // checked for every LSN tried, persistent_lsn_ only grows so that it is
+  // still there when the reservation succeeds
+  lsn_t lsn;
+  for (;;) {
+    lsn = next_lsn_;
+    if (lsn + size > persistent_lsn_ + 1 + LOG_RING_SIZE) {
+      waitForRoom(lsn + size);
+      continue;
+    }
+    if (next_lsn_.compare_exchange_weak(lsn, lsn + size)) {
+      break;
+    }
+  }
+  log_record.lsn_ = lsn;
+  trackTxn(log_record);
+  int pos = static_cast<int>(log_record.lsn_ % LOG_RING_SIZE);
+  log_record.SerializeTo(log_buffer_ + pos);
+  if (pos + size > LOG_RING_SIZE) {
+    memcpy(log_buffer_, log_buffer_ + LOG_RING_SIZE,
+           pos + size - LOG_RING_SIZE);
+  }
+  completed_[pos].store(size, std::memory_order_release);
+  return log_record.lsn_;
+}
+
+/*
+ * every record before the BEGIN record is published once it is on disk, and
+ * the transaction table has it. Records appended later may be in the copy as
+ * well; analysis reads them anyway
+ */
+lsn_t LogManager::BeginCheckpoint(
+    std::vector<std::pair<txn_id_t, lsn_t>> &active_txns, lsn_t &oldest_lsn) {
+  LogRecord log_record(INVALID_TXN_ID, INVALID_LSN,
+                       LogRecordType::CHECKPOINT_BEGIN);
+  lsn_t lsn = AppendLogRecord(log_record);
+  Flush(lsn);
+  active_txns.clear();
+  oldest_lsn = lsn;
+  for (auto &shard : active_txns_) {
+    std::lock_guard<std::mutex> guard(shard.latch_);
+    for (auto &txn : shard.txns_) {
+      active_txns.emplace_back(txn.first, txn.second.second);
+      oldest_lsn = std::min(oldest_lsn, txn.second.first);
+    }
+  }
+  return lsn;
+}
+
+/*
+ * the ring is free up to end once the log is written up to end minus the
+ * ring size. Appends waiting for room line up on room_latch_, so that a
+ * write wakes one of them and not all
+ */
+void LogManager::waitForRoom(lsn_t end) {
+  std::lock_guard<std::mutex> guard(room_latch_);
+  std::unique_lock<std::mutex> lock(latch_);
+  while (persistent_lsn_ + 1 + LOG_RING_SIZE < end) {
+    if (!running_) {
+      if (!flushLogBuffer(lock)) {
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+      }
+      continue;
+    }
+    flush_requested_ = true;
+    cv_.notify_one();
+    append_cv_.wait(lock);
+  }
+}
+
+/*
+ * the records of a transaction come from one thread, its shard is hardly
+ * ever contended
+ */
+void LogManager::trackTxn(const LogRecord &log_record) {
+  if (log_record.txn_id_ == INVALID_TXN_ID) {
+    return;
+  }
+  ActiveTxns &shard = active_txns_[static_cast<uint32_t>(log_record.txn_id_) %
+                                   ACTIVE_TXN_SHARDS];
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  if (log_record.log_record_type_ == LogRecordType::COMMIT ||
+      log_record.log_record_type_ == LogRecordType::ABORT) {
+    shard.txns_.erase(log_record.txn_id_);
+    return;
+  }
+  auto entry = shard.txns_.emplace(
+      log_record.txn_id_, std::make_pair(log_record.lsn_, log_record.lsn_));
+  entry.first->second.second = log_record.lsn_;
+}
 
-  return INVALID_LSN;
+/*
+ * Commits wait here for their COMMIT record, and the buffer pool manager for
+ * the last record of a page it is about to write. Waiters that come while a
+ * write is running are served together by the next one. An lsn that was not
+ * handed out yet waits for every record appended so far
+ */
+void LogManager::Flush(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  lsn = std::min(lsn, next_lsn_ - 1);
+  while (persistent_lsn_ < lsn) {
+    if (!running_) {
+      if (!flushLogBuffer(lock)) {
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+      }
+      continue;
+    }
+    flush_requested_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(lock);
+  }
 }
 
 } // namespace cmudb
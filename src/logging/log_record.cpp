@@ -0,0 +1,375 @@
+/**
+ * log_record.cpp
+ */
+
+#include <cstring>
+#include <limits>
+
+#include "common/crc32c.h"
+#include "logging/log_record.h"
+
+namespace cmudb {
+
+namespace {
+
+// equal bytes between two changed ranges of an update that are logged with
+// them: a new run costs at least two bytes (skip and length)
+const int32_t MERGE_GAP = 2;
+
+// with data nullptr, pos only moves past the value
+inline void putVarint(char *data, int &pos, uint64_t value) {
+  while (value >= 0x80) {
+    if (data != nullptr) {
+      data[pos] = static_cast<char>(value | 0x80);
+    }
+    pos++;
+    value >>= 7;
+  }
+  if (data != nullptr) {
+    data[pos] = static_cast<char>(value);
+  }
+  pos++;
+}
+
+// ids and LSNs plus one, the invalid ones are 0
+inline void putId(char *data, int &pos, int64_t id) {
+  putVarint(data, pos, static_cast<uint64_t>(id + 1));
+}
+
+inline void putBytes(char *data, int &pos, const char *bytes, int32_t len) {
+  if (data != nullptr) {
+    memcpy(data + pos, bytes, len);
+  }
+  pos += len;
+}
+
+inline void putRid(char *data, int &pos, const RID &rid) {
+  putId(data, pos, rid.GetPageId());
+  putId(data, pos, rid.GetSlotNum());
+}
+
+inline void putTuple(char *data, int &pos, const Tuple &tuple) {
+  putVarint(data, pos, tuple.GetLength());
+  putBytes(data, pos, tuple.GetData(), tuple.GetLength());
+}
+
+template <typename T>
+void putEntries(char *data, int &pos,
+                const std::vector<std::pair<T, lsn_t>> &entries) {
+  putVarint(data, pos, entries.size());
+  for (auto &entry : entries) {
+    putId(data, pos, entry.first);
+    putId(data, pos, entry.second);
+  }
+}
+
+// the getters fail on a value that runs past end or does not fit
+bool getVarint(const char *&pos, const char *end, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; pos < end && shift < 64; shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(*pos++);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T> bool getId(const char *&pos, const char *end, T &id) {
+  uint64_t value;
+  if (!getVarint(pos, end, value) ||
+      value > static_cast<uint64_t>(std::numeric_limits<T>::max()) + 1) {
+    return false;
+  }
+  id = static_cast<T>(static_cast<int64_t>(value) - 1);
+  return true;
+}
+
+// a length of bytes that follow, within end
+bool getLength(const char *&pos, const char *end, int32_t &len) {
+  uint64_t value;
+  if (!getVarint(pos, end, value) ||
+      value > static_cast<uint64_t>(end - pos)) {
+    return false;
+  }
+  len = static_cast<int32_t>(value);
+  return true;
+}
+
+bool getRid(const char *&pos, const char *end, RID &rid) {
+  page_id_t page_id;
+  int32_t slot_num;
+  if (!getId(pos, end, page_id) || !getId(pos, end, slot_num)) {
+    return false;
+  }
+  rid.Set(page_id, slot_num);
+  return true;
+}
+
+bool getTuple(const char *&pos, const char *end, Tuple &tuple) {
+  int32_t len;
+  if (!getLength(pos, end, len)) {
+    return false;
+  }
+  tuple.DeserializeFrom(pos, len);
+  pos += len;
+  return true;
+}
+
+template <typename T>
+bool getEntries(const char *&pos, const char *end,
+                std::vector<std::pair<T, lsn_t>> &entries) {
+  int32_t count;
+  // an entry takes two bytes at least
+  if (!getLength(pos, end, count) || count > (end - pos) / 2) {
+    return false;
+  }
+  entries.resize(count);
+  for (auto &entry : entries) {
+    if (!getId(pos, end, entry.first) || !getId(pos, end, entry.second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t checksum(const char *data, int size, lsn_t lsn) {
+  uint32_t crc = Crc32c(reinterpret_cast<const char *>(&lsn), sizeof(lsn_t));
+  return Crc32c(data + sizeof(uint32_t), size - sizeof(uint32_t), crc);
+}
+
+} // namespace
+
+/*
+ * the changed ranges of an update that keeps the tuple size. The delta is
+ * logged unless it does not come out smaller than both images
+ */
+void LogRecord::diffUpdate() {
+  const char *old_data = old_tuple_.GetData();
+  const char *new_data = new_tuple_.GetData();
+  int32_t size = old_tuple_.GetLength();
+  update_runs_.clear();
+  for (int32_t i = 0; i < size; i++) {
+    if (old_data[i] == new_data[i]) {
+      continue;
+    }
+    if (!update_runs_.empty() &&
+        i - update_runs_.back().first - update_runs_.back().second <=
+            MERGE_GAP) {
+      update_runs_.back().second = i + 1 - update_runs_.back().first;
+    } else {
+      update_runs_.emplace_back(i, 1);
+    }
+  }
+
+  int delta_size = 0, full_size = 0;
+  putVarint(nullptr, delta_size, update_runs_.size() * 2 + 1);
+  putVarint(nullptr, delta_size, size);
+  int32_t offset = 0;
+  for (auto &run : update_runs_) {
+    putVarint(nullptr, delta_size, run.first - offset);
+    putVarint(nullptr, delta_size, run.second);
+    delta_size += run.second;
+    offset = run.first + run.second;
+  }
+  putVarint(nullptr, full_size, 0);
+  putTuple(nullptr, full_size, old_tuple_);
+  putTuple(nullptr, full_size, new_tuple_);
+  update_delta_ = delta_size < full_size;
+  if (!update_delta_) {
+    update_runs_.clear();
+  }
+}
+
+int LogRecord::encodedSize() const {
+  int length = encodeFields(nullptr);
+  int size = sizeof(uint32_t);
+  putVarint(nullptr, size, length);
+  return size + length;
+}
+
+int LogRecord::encodeFields(char *data) const {
+  int pos = 0;
+  putVarint(data, pos, static_cast<uint64_t>(log_record_type_));
+  putId(data, pos, txn_id_);
+  putId(data, pos, prev_lsn_);
+  if (log_record_type_ == LogRecordType::CLR) {
+    putId(data, pos, undo_next_lsn_);
+    putVarint(data, pos, static_cast<uint64_t>(change_type_));
+  }
+  switch (GetChangeType()) {
+  case LogRecordType::INSERT:
+    putRid(data, pos, insert_rid_);
+    putTuple(data, pos, insert_tuple_);
+    break;
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    putRid(data, pos, delete_rid_);
+    putTuple(data, pos, delete_tuple_);
+    break;
+  case LogRecordType::UPDATE: {
+    putRid(data, pos, update_rid_);
+    if (!update_delta_) {
+      putVarint(data, pos, 0);
+      putTuple(data, pos, old_tuple_);
+      putTuple(data, pos, new_tuple_);
+      break;
+    }
+    putVarint(data, pos, update_runs_.size() * 2 + 1);
+    putVarint(data, pos, old_tuple_.GetLength());
+    const char *old_data = old_tuple_.GetData();
+    const char *new_data = new_tuple_.GetData();
+    int32_t offset = 0;
+    for (auto &run : update_runs_) {
+      putVarint(data, pos, run.first - offset);
+      putVarint(data, pos, run.second);
+      if (data != nullptr) {
+        for (int32_t i = run.first; i < run.first + run.second; i++) {
+          data[pos++] = old_data[i] ^ new_data[i];
+        }
+      } else {
+        pos += run.second;
+      }
+      offset = run.first + run.second;
+    }
+    break;
+  }
+  case LogRecordType::NEWPAGE:
+    putId(data, pos, prev_page_id_);
+    putId(data, pos, page_id_);
+    break;
+  case LogRecordType::CHECKPOINT_END:
+    putEntries(data, pos, active_txns_);
+    putEntries(data, pos, dirty_pages_);
+    break;
+  default:
+    break;
+  }
+  return pos;
+}
+
+void LogRecord::SerializeTo(char *data) const {
+  assert(lsn_ != INVALID_LSN);
+  int pos = sizeof(uint32_t);
+  putVarint(data, pos, encodeFields(nullptr));
+  pos += encodeFields(data + pos);
+  assert(pos == size_);
+  uint32_t crc = checksum(data, size_, lsn_);
+  memcpy(data, &crc, sizeof(uint32_t));
+}
+
+bool LogRecord::DeserializeFrom(const char *data, int available, lsn_t lsn) {
+  if (available <= static_cast<int>(sizeof(uint32_t))) {
+    return false;
+  }
+  const char *pos = data + sizeof(uint32_t);
+  int32_t length;
+  if (!getLength(pos, data + available, length) || length == 0) {
+    return false;
+  }
+  const char *end = pos + length;
+  uint32_t crc;
+  memcpy(&crc, data, sizeof(uint32_t));
+  if (crc != checksum(data, static_cast<int>(end - data), lsn) ||
+      !decodeFields(pos, end)) {
+    return false;
+  }
+  size_ = static_cast<int32_t>(end - data);
+  lsn_ = lsn;
+  return true;
+}
+
+bool LogRecord::decodeFields(const char *pos, const char *end) {
+  uint64_t type;
+  if (!getVarint(pos, end, type) ||
+      type <= static_cast<uint64_t>(LogRecordType::INVALID) ||
+      type > static_cast<uint64_t>(LogRecordType::CLR) ||
+      !getId(pos, end, txn_id_) || !getId(pos, end, prev_lsn_)) {
+    return false;
+  }
+  log_record_type_ = static_cast<LogRecordType>(type);
+  if (log_record_type_ == LogRecordType::CLR) {
+    // only changes of table pages are undone
+    if (!getId(pos, end, undo_next_lsn_) || !getVarint(pos, end, type) ||
+        type < static_cast<uint64_t>(LogRecordType::INSERT) ||
+        type > static_cast<uint64_t>(LogRecordType::UPDATE)) {
+      return false;
+    }
+    change_type_ = static_cast<LogRecordType>(type);
+  }
+  update_delta_ = false;
+  bool read = true;
+  switch (GetChangeType()) {
+  case LogRecordType::INSERT:
+    read = getRid(pos, end, insert_rid_) && getTuple(pos, end, insert_tuple_);
+    break;
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    read = getRid(pos, end, delete_rid_) && getTuple(pos, end, delete_tuple_);
+    break;
+  case LogRecordType::UPDATE: {
+    uint64_t form;
+    if (!getRid(pos, end, update_rid_) || !getVarint(pos, end, form)) {
+      return false;
+    }
+    if (form == 0) {
+      read = getTuple(pos, end, old_tuple_) && getTuple(pos, end, new_tuple_);
+      break;
+    }
+    // the tuple size is not bounded by the record, only its runs are
+    uint64_t size;
+    if ((form & 1) == 0 || !getVarint(pos, end, size) ||
+        size > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+      return false;
+    }
+    update_delta_ = true;
+    update_xor_.assign(size, '\0');
+    uint64_t offset = 0;
+    for (uint64_t runs = form >> 1; runs > 0; runs--) {
+      uint64_t skip;
+      int32_t len;
+      if (!getVarint(pos, end, skip) || skip > size - offset ||
+          !getLength(pos, end, len) ||
+          static_cast<uint64_t>(len) > size - offset - skip) {
+        return false;
+      }
+      offset += skip;
+      memcpy(&update_xor_[offset], pos, len);
+      pos += len;
+      offset += len;
+    }
+    break;
+  }
+  case LogRecordType::NEWPAGE:
+    read = getId(pos, end, prev_page_id_) && getId(pos, end, page_id_);
+    break;
+  case LogRecordType::CHECKPOINT_END:
+    read = getEntries(pos, end, active_txns_) &&
+           getEntries(pos, end, dirty_pages_);
+    break;
+  default:
+    break;
+  }
+  return read && pos == end;
+}
+
+/*
+ * XOR the image with the changed ranges: the old image gives the new one,
+ * the new image the old one
+ */
+Tuple LogRecord::ApplyUpdateDelta(const Tuple &image) const {
+  assert(update_delta_ &&
+         image.GetLength() == static_cast<int32_t>(update_xor_.size()));
+  Tuple tuple;
+  tuple.DeserializeFrom(image.GetData(), image.GetLength());
+  char *data = tuple.GetData();
+  for (size_t i = 0; i < update_xor_.size(); i++) {
+    data[i] ^= update_xor_[i];
+  }
+  return tuple;
+}
+
+} // namespace cmudb
@@ -2,33 +2,472 @@
  * log_recovey.cpp
  */
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "common/logger.h"
 #include "logging/log_recovery.h"
+#include "page/header_page.h"
 #include "page/table_page.h"
 
 namespace cmudb {
+
+namespace {
+
+// records the reader hands to a redo worker at once, and batches a worker
+// may have queued before the reader waits for it
+const size_t REDO_BATCH_SIZE = 256;
+const size_t REDO_QUEUE_BATCHES = 16;
+
+} // namespace
+
+// redoes the records of the pages page_id % num_redo_threads_ == its index
+struct LogRecovery::RedoWorker {
+  // filled by the reader, handed over once REDO_BATCH_SIZE records are in
+  std::vector<std::pair<page_id_t, LogRecord>> pending_;
+  std::deque<std::vector<std::pair<page_id_t, LogRecord>>> batches_;
+  bool done_ = false;
+  std::mutex latch_;
+  std::condition_variable cv_;
+  std::thread thread_;
+
+  void HandOff() {
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this] { return batches_.size() < REDO_QUEUE_BATCHES; });
+    batches_.push_back(std::move(pending_));
+    pending_.clear();
+    cv_.notify_all();
+  }
+};
+
 /*
  * deserialize a log record from log buffer
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
+ * data points into log_buffer_, a record has to end within it. The record
+ * checks out only if it was written at lsn, see log_record.h
  */
-bool LogRecovery::DeserializeLogRecord(const char *data,
+bool LogRecovery::DeserializeLogRecord(const char *data, lsn_t lsn,
                                              LogRecord &log_record) {
-  return false;
+  int available = static_cast<int>(log_buffer_ + LOG_BUFFER_SIZE - data);
+  return log_record.DeserializeFrom(data, available, lsn);
+}
+
+/*
+ * position the scan of the log at offset
+ */
+void LogRecovery::startScan(lsn_t offset) {
+  offset_ = offset;
+  buffer_pos_ = 0;
+  if (!disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset_)) {
+    memset(log_buffer_, 0, LOG_BUFFER_SIZE);
+  }
+}
+
+/*
+ * next record of the scan and its offset in the log. The buffer is refilled
+ * from the first record it does not hold whole. false at the end of the log,
+ * or at a record that does not check out (torn, or an old one of a recycled
+ * segment), unless the next segment starts with a record
+ */
+bool LogRecovery::nextLogRecord(LogRecord &log_record, lsn_t &offset) {
+  offset = offset_ + buffer_pos_;
+  bool read =
+      DeserializeLogRecord(log_buffer_ + buffer_pos_, offset, log_record);
+  if (!read && buffer_pos_ != 0) {
+    startScan(offset);
+    read = DeserializeLogRecord(log_buffer_, offset, log_record);
+  }
+  if (!read) {
+    // a log opened without recovery goes on at the start of the next
+    // segment. A segment is synced before the next one is written to, so
+    // records there never follow a hole
+    int segment_size = disk_manager_->GetLogSegmentSize();
+    offset = (offset / segment_size + 1) * segment_size;
+    startScan(offset);
+    if (!DeserializeLogRecord(log_buffer_, offset, log_record)) {
+      return false;
+    }
+  }
+  buffer_pos_ += log_record.size_;
+  return true;
+}
+
+/*
+ * the table pages a record changes. A NEWPAGE record changes the new page
+ * and the one linking to it
+ */
+int LogRecovery::getPages(const LogRecord &log_record, page_id_t *pages) {
+  switch (log_record.GetChangeType()) {
+  case LogRecordType::INSERT:
+    pages[0] = log_record.insert_rid_.GetPageId();
+    return 1;
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    pages[0] = log_record.delete_rid_.GetPageId();
+    return 1;
+  case LogRecordType::UPDATE:
+    pages[0] = log_record.update_rid_.GetPageId();
+    return 1;
+  case LogRecordType::NEWPAGE:
+    pages[0] = log_record.page_id_;
+    if (log_record.prev_page_id_ == INVALID_PAGE_ID) {
+      return 1;
+    }
+    pages[1] = log_record.prev_page_id_;
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+/*
+ * LSN of the last checkpoint the header page records, if a CHECKPOINT_BEGIN
+ * record is there. Otherwise the log is read from the start
+ */
+lsn_t LogRecovery::checkpointLSN() {
+  lsn_t log_start = disk_manager_->GetLogStart();
+  if (disk_manager_->GetNumPages() <= HEADER_PAGE_ID) {
+    return log_start;
+  }
+  auto header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  lsn_t lsn = HeaderPage::ReadPageSize(header_page->GetData()) == 0
+                  ? 0
+                  : header_page->GetCheckpointLSN();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+
+  LogRecord log_record;
+  if (lsn <= 0 ||
+      !disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, lsn) ||
+      !DeserializeLogRecord(log_buffer_, lsn, log_record) ||
+      log_record.log_record_type_ != LogRecordType::CHECKPOINT_BEGIN) {
+    return log_start;
+  }
+  return lsn;
+}
+
+/*
+ * analysis pass: read the log from the last checkpoint on, build active_txn_
+ * (transactions without COMMIT/ABORT record and their last record) and the
+ * dirty page table. A CHECKPOINT_END record adds the transactions that
+ * have no record since its BEGIN record, and lowers recLSNs to those of
+ * pages dirty at the checkpoint
+ */
+void LogRecovery::analyze() {
+  active_txn_.clear();
+  dirty_page_table_.clear();
+  std::unordered_set<txn_id_t> seen_txns;
+
+  LogRecord log_record;
+  lsn_t offset;
+  page_id_t pages[2];
+  log_end_ = checkpointLSN();
+  startScan(log_end_);
+  while (nextLogRecord(log_record, offset)) {
+    log_end_ = offset + log_record.size_;
+    switch (log_record.log_record_type_) {
+    case LogRecordType::CHECKPOINT_BEGIN:
+      break;
+    case LogRecordType::CHECKPOINT_END:
+      for (auto &txn : log_record.active_txns_) {
+        if (seen_txns.count(txn.first) == 0) {
+          active_txn_.emplace(txn.first, txn.second);
+        }
+      }
+      for (auto &page : log_record.dirty_pages_) {
+        auto dirty = dirty_page_table_.emplace(page.first, page.second);
+        if (!dirty.second) {
+          dirty.first->second = std::min(dirty.first->second, page.second);
+        }
+      }
+      break;
+    case LogRecordType::COMMIT:
+    case LogRecordType::ABORT:
+      seen_txns.insert(log_record.txn_id_);
+      active_txn_.erase(log_record.txn_id_);
+      break;
+    default:
+      seen_txns.insert(log_record.txn_id_);
+      active_txn_[log_record.txn_id_] = log_record.lsn_;
+      for (int i = getPages(log_record, pages); i-- > 0;) {
+        dirty_page_table_.emplace(pages[i], log_record.lsn_);
+      }
+      break;
+    }
+  }
+}
+
+/*
+ * redo one record on one of its pages, unless the page LSN shows the page
+ * already holds the change
+ */
+void LogRecovery::redoRecord(const LogRecord &log_record, page_id_t page_id) {
+  bool new_page = log_record.log_record_type_ == LogRecordType::NEWPAGE &&
+                  page_id == log_record.page_id_;
+  if (new_page) {
+    disk_manager_->MarkPageAllocated(page_id);
+  }
+  auto page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  assert(page != nullptr);
+  page->WLatch();
+  bool redo = page->GetLSN() < log_record.lsn_;
+  if (redo) {
+    Tuple old_tuple;
+    switch (log_record.GetChangeType()) {
+    case LogRecordType::INSERT:
+      page->InsertTupleAt(log_record.insert_tuple_, log_record.insert_rid_);
+      break;
+    case LogRecordType::MARKDELETE:
+      page->MarkDelete(log_record.delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      page->ApplyDelete(log_record.delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      page->RollbackDelete(log_record.delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE:
+      if (log_record.IsUpdateDelta()) {
+        // records of a page are redone in log order, it holds the old image
+        page->GetTuple(log_record.update_rid_, old_tuple, nullptr, nullptr);
+        page->UpdateTuple(log_record.ApplyUpdateDelta(old_tuple), old_tuple,
+                          log_record.update_rid_, nullptr, nullptr, nullptr);
+        break;
+      }
+      page->UpdateTuple(log_record.new_tuple_, old_tuple,
+                        log_record.update_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::NEWPAGE:
+      if (new_page) {
+        page->Init(page_id, page->GetContentSize(), log_record.prev_page_id_,
+                   nullptr, nullptr);
+      } else {
+        page->SetNextPageId(log_record.page_id_);
+      }
+      break;
+    default:
+      break;
+    }
+    page->SetLSN(log_record.lsn_);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, redo);
+}
+
+void LogRecovery::runRedoWorker(RedoWorker *worker) {
+  std::unique_lock<std::mutex> lock(worker->latch_);
+  while (true) {
+    worker->cv_.wait(lock, [worker] {
+      return !worker->batches_.empty() || worker->done_;
+    });
+    if (worker->batches_.empty()) {
+      return;
+    }
+    auto batch = std::move(worker->batches_.front());
+    worker->batches_.pop_front();
+    worker->cv_.notify_all();
+    lock.unlock();
+    for (auto &entry : batch) {
+      redoRecord(entry.second, entry.first);
+    }
+    lock.lock();
+  }
 }
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
  *read log file from the beginning to end (you must prefetch log records into
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
- *LSN with log_record's sequence number, and also build active_txn_ table &
- *lsn_mapping_ table
+ *LSN with log_record's sequence number, and also build active_txn_ table
+ *
+ *The reader starts at the smallest recLSN of the dirty page table and skips
+ *records older than the recLSN of their page. With more than one thread,
+ *records go to the worker of their page, so that the records of a page are
+ *redone in log order while different pages are redone in parallel
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  assert(!ENABLE_LOGGING);
+  analyze();
+  // a torn last record goes, so that new records start at their LSN
+  disk_manager_->TruncateLog(log_end_);
+  if (log_manager_ != nullptr) {
+    log_manager_->SetNextLSN(log_end_);
+    log_manager_->SetPersistentLSN(log_end_ - 1);
+  }
+  if (dirty_page_table_.empty()) {
+    return;
+  }
+  lsn_t redo_lsn = log_end_;
+  for (auto &entry : dirty_page_table_) {
+    redo_lsn = std::min(redo_lsn, entry.second);
+  }
+
+  std::vector<std::unique_ptr<RedoWorker>> workers;
+  if (num_redo_threads_ > 1) {
+    for (size_t i = 0; i < num_redo_threads_; i++) {
+      workers.emplace_back(new RedoWorker);
+      workers.back()->thread_ =
+          std::thread(&LogRecovery::runRedoWorker, this, workers.back().get());
+    }
+  }
+
+  LogRecord log_record;
+  lsn_t offset;
+  page_id_t pages[2];
+  startScan(redo_lsn);
+  while (nextLogRecord(log_record, offset)) {
+    for (int i = getPages(log_record, pages); i-- > 0;) {
+      auto dirty = dirty_page_table_.find(pages[i]);
+      if (dirty == dirty_page_table_.end() ||
+          log_record.lsn_ < dirty->second) {
+        continue;
+      }
+      if (workers.empty()) {
+        redoRecord(log_record, pages[i]);
+        continue;
+      }
+      RedoWorker &worker = *workers[pages[i] % workers.size()];
+      worker.pending_.emplace_back(pages[i], log_record);
+      if (worker.pending_.size() == REDO_BATCH_SIZE) {
+        worker.HandOff();
+      }
+    }
+  }
+
+  for (auto &worker : workers) {
+    if (!worker->pending_.empty()) {
+      worker->HandOff();
+    }
+    {
+      std::lock_guard<std::mutex> guard(worker->latch_);
+      worker->done_ = true;
+    }
+    worker->cv_.notify_all();
+  }
+  for (auto &worker : workers) {
+    worker->thread_.join();
+  }
+}
+
+/*
+ * roll back the change of one record of an unfinished transaction. With a
+ * log manager the rollback is logged as a CLR, continuing the chain of the
+ * transaction at prev_lsn. Its undo next LSN is the record before the one
+ * undone: after a crash during undo, the next undo picks up there
+ */
+void LogRecovery::undoRecord(LogRecord &log_record, lsn_t &prev_lsn) {
+  page_id_t pages[2];
+  if (log_record.log_record_type_ == LogRecordType::NEWPAGE ||
+      getPages(log_record, pages) == 0) {
+    // a new page stays in the table, empty
+    return;
+  }
+  auto page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(pages[0]));
+  assert(page != nullptr);
+  page->WLatch();
+  txn_id_t txn_id = log_record.txn_id_;
+  LogRecord change;
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+    page->ApplyDelete(log_record.insert_rid_, nullptr, nullptr);
+    change = LogRecord(txn_id, prev_lsn, LogRecordType::APPLYDELETE,
+                       log_record.insert_rid_, log_record.insert_tuple_);
+    break;
+  case LogRecordType::MARKDELETE:
+    page->RollbackDelete(log_record.delete_rid_, nullptr, nullptr);
+    change = LogRecord(txn_id, prev_lsn, LogRecordType::ROLLBACKDELETE,
+                       log_record.delete_rid_, log_record.delete_tuple_);
+    break;
+  case LogRecordType::ROLLBACKDELETE:
+    page->MarkDelete(log_record.delete_rid_, nullptr, nullptr, nullptr);
+    change = LogRecord(txn_id, prev_lsn, LogRecordType::MARKDELETE,
+                       log_record.delete_rid_, log_record.delete_tuple_);
+    break;
+  case LogRecordType::APPLYDELETE:
+    page->InsertTupleAt(log_record.delete_tuple_, log_record.delete_rid_);
+    change = LogRecord(txn_id, prev_lsn, LogRecordType::INSERT,
+                       log_record.delete_rid_, log_record.delete_tuple_);
+    break;
+  case LogRecordType::UPDATE: {
+    Tuple new_tuple;
+    if (log_record.IsUpdateDelta()) {
+      // the tuple is still the new image, the transaction holds its lock
+      page->GetTuple(log_record.update_rid_, new_tuple, nullptr, nullptr);
+      log_record.old_tuple_ = log_record.ApplyUpdateDelta(new_tuple);
+      log_record.new_tuple_ = new_tuple;
+    }
+    page->UpdateTuple(log_record.old_tuple_, new_tuple,
+                      log_record.update_rid_, nullptr, nullptr, nullptr);
+    change = LogRecord(txn_id, prev_lsn, LogRecordType::UPDATE,
+                       log_record.update_rid_, log_record.new_tuple_,
+                       log_record.old_tuple_);
+    break;
+  }
+  default:
+    break;
+  }
+  if (log_manager_ != nullptr) {
+    LogRecord rollback(change, log_record.prev_lsn_);
+    prev_lsn = log_manager_->AppendLogRecord(rollback);
+    page->SetLSN(prev_lsn);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(pages[0], true);
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
+ *
+ *The records of all unfinished transactions are undone in one backward pass,
+ *latest first, following the prev_lsn_ chains. A CLR is not undone, the
+ *chain goes on at its undo next LSN. A transaction whose BEGIN is reached
+ *gets its ABORT record
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  std::priority_queue<std::pair<lsn_t, txn_id_t>> to_undo;
+  for (auto &txn : active_txn_) {
+    to_undo.emplace(txn.second, txn.first);
+  }
+  lsn_t last_lsn = INVALID_LSN;
+  while (!to_undo.empty()) {
+    lsn_t lsn = to_undo.top().first;
+    txn_id_t txn_id = to_undo.top().second;
+    to_undo.pop();
+    LogRecord log_record;
+    if (!disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, lsn) ||
+        !DeserializeLogRecord(log_buffer_, lsn, log_record)) {
+      LOG_DEBUG("can not read log record %lld to undo",
+                static_cast<long long>(lsn));
+      continue;
+    }
+    lsn_t &prev_lsn = active_txn_[txn_id];
+    lsn_t undo_next_lsn = log_record.prev_lsn_;
+    if (log_record.log_record_type_ == LogRecordType::CLR) {
+      // undone before a crash during an earlier recovery
+      undo_next_lsn = log_record.undo_next_lsn_;
+    } else {
+      undoRecord(log_record, prev_lsn);
+    }
+    if (undo_next_lsn != INVALID_LSN) {
+      to_undo.emplace(undo_next_lsn, txn_id);
+    } else if (log_manager_ != nullptr) {
+      LogRecord abort(txn_id, prev_lsn, LogRecordType::ABORT);
+      last_lsn = log_manager_->AppendLogRecord(abort);
+    }
+  }
+  if (log_manager_ != nullptr && last_lsn != INVALID_LSN) {
+    log_manager_->Flush(last_lsn);
+  }
+  active_txn_.clear();
+}
 
 } // namespace cmudb
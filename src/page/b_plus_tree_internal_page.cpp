@@ -19,13 +19,13 @@ namespace cmudb {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id,
-                                          page_id_t parent_id) {
+                                          page_id_t parent_id, int page_size) {
     SetPageType(IndexPageType::INTERNAL_PAGE);
     SetSize(0);
-    assert(sizeof(BPlusTreeInternalPage) == 24);
+    assert(sizeof(BPlusTreeInternalPage) == 28);
 
     // Ԥһʱ
-    int max_size = (PAGE_SIZE - sizeof(BPlusTreeInternalPage)) / sizeof(MappingType) - 1;
+    int max_size = (page_size - sizeof(BPlusTreeInternalPage)) / sizeof(MappingType) - 1;
     SetMaxSize(max_size);
 
     SetParentPageId(parent_id);
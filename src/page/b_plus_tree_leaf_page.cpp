@@ -22,13 +22,14 @@ namespace cmudb {
  * next page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id) {
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id,
+                                      int page_size) {
     SetPageType(IndexPageType::LEAF_PAGE);
     SetSize(0);
-    assert(sizeof(BPlusTreeLeafPage) == 28);
+    assert(sizeof(BPlusTreeLeafPage) == 32);
 
     // һѵʱ
-    int max_size = (PAGE_SIZE - sizeof(BPlusTreeLeafPage)) / sizeof(MappingType) - 1;
+    int max_size = (page_size - sizeof(BPlusTreeLeafPage)) / sizeof(MappingType) - 1;
     SetMaxSize(max_size);
     SetPageId(page_id);
     SetParentPageId(parent_id);
@@ -17,9 +17,9 @@ bool HeaderPage::InsertRecord(const std::string &name,
   assert(root_id > INVALID_PAGE_ID);
 
   int record_num = GetRecordCount();
-  int offset = 4 + record_num * 36;
-  // check for duplicate name
-  if (FindRecord(name) != -1)
+  int offset = HEADER_PAGE_PREFIX_SIZE + record_num * 36;
+  // check for duplicate name, and for room
+  if (FindRecord(name) != -1 || offset + 36 > GetContentSize())
     return false;
   // copy record content
   memcpy(GetData() + offset, name.c_str(), (name.length() + 1));
@@ -37,7 +37,7 @@ bool HeaderPage::DeleteRecord(const std::string &name) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
+  int offset = HEADER_PAGE_PREFIX_SIZE + index * 36;
   memmove(GetData() + offset, GetData() + offset + 36,
           (record_num - index - 1) * 36);
 
@@ -53,7 +53,7 @@ bool HeaderPage::UpdateRecord(const std::string &name,
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
+  int offset = HEADER_PAGE_PREFIX_SIZE + index * 36;
   // update record content, only root_id
   memcpy((GetData() + offset + 32), &root_id, 4);
 
@@ -67,7 +67,7 @@ bool HeaderPage::GetRootId(const std::string &name, page_id_t &root_id) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = (index + 1) * 36;
+  int offset = HEADER_PAGE_PREFIX_SIZE + index * 36 + 32;
   root_id = *reinterpret_cast<page_id_t *>(GetData() + offset);
 
   return true;
@@ -81,13 +81,24 @@ int HeaderPage::GetRecordCount() { return *reinterpret_cast<int *>(GetData()); }
 
 void HeaderPage::SetRecordCount(int record_count) {
   memcpy(GetData(), &record_count, 4);
+  int magic = HEADER_PAGE_MAGIC;
+  int page_size = GetPageSize();
+  memcpy(GetData() + 12, &magic, 4);
+  memcpy(GetData() + 16, &page_size, 4);
+}
+
+int HeaderPage::ReadPageSize(const char *data) {
+  int magic, page_size;
+  memcpy(&magic, data + 12, 4);
+  memcpy(&page_size, data + 16, 4);
+  return magic == HEADER_PAGE_MAGIC ? page_size : 0;
 }
 
 int HeaderPage::FindRecord(const std::string &name) {
   int record_num = GetRecordCount();
 
   for (int i = 0; i < record_num; i++) {
-    char *raw_name = reinterpret_cast<char *>(GetData() + (4 + i * 36));
+    char *raw_name = reinterpret_cast<char *>(GetData() + (HEADER_PAGE_PREFIX_SIZE + i * 36));
     if (strcmp(raw_name, name.c_str()) == 0)
       return i;
   }
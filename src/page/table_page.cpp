@@ -15,7 +15,11 @@ void TablePage::Init(page_id_t page_id, size_t page_size,
                      Transaction *txn) {
   memcpy(GetData(), &page_id, 4); // set page_id
   if (ENABLE_LOGGING) {
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::NEWPAGE, prev_page_id, page_id);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
   SetPrevPageId(prev_page_id);
   SetNextPageId(INVALID_PAGE_ID);
@@ -28,19 +32,19 @@ page_id_t TablePage::GetPageId() {
 }
 
 page_id_t TablePage::GetPrevPageId() {
-  return *reinterpret_cast<page_id_t *>(GetData() + 8);
+  return *reinterpret_cast<page_id_t *>(GetData() + 12);
 }
 
 page_id_t TablePage::GetNextPageId() {
-  return *reinterpret_cast<page_id_t *>(GetData() + 12);
+  return *reinterpret_cast<page_id_t *>(GetData() + 16);
 }
 
 void TablePage::SetPrevPageId(page_id_t prev_page_id) {
-  memcpy(GetData() + 8, &prev_page_id, 4);
+  memcpy(GetData() + 12, &prev_page_id, 4);
 }
 
 void TablePage::SetNextPageId(page_id_t next_page_id) {
-  memcpy(GetData() + 12, &next_page_id, 4);
+  memcpy(GetData() + 16, &next_page_id, 4);
 }
 
 /**
@@ -87,7 +91,11 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
   if (ENABLE_LOGGING) {
     // acquire the exclusive lock
     assert(lock_manager->LockExclusive(txn, rid.Get()));
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::INSERT, rid, tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
   // LOG_DEBUG("Tuple inserted");
   return true;
@@ -128,7 +136,19 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn,
                !lock_manager->LockExclusive(txn, rid)) { // no shared lock
       return false;
     }
-    // TODO: add your logging logic here
+    // copy out the tuple, for undo purpose
+    Tuple delete_tuple;
+    delete_tuple.size_ = tuple_size;
+    delete_tuple.data_ = new char[delete_tuple.size_];
+    memcpy(delete_tuple.data_, GetData() + GetTupleOffset(slot_num),
+           delete_tuple.size_);
+    delete_tuple.rid_ = rid;
+    delete_tuple.allocated_ = true;
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::MARKDELETE, rid, delete_tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
 
   // set tuple size to negative value
@@ -182,7 +202,11 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
                !lock_manager->LockExclusive(txn, rid)) { // no shared lock
       return false;
     }
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::UPDATE, rid, old_tuple, new_tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
 
   // update
@@ -234,7 +258,11 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
     // must already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
            txn->GetExclusiveLockSet()->end());
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::APPLYDELETE, rid, delete_tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
 
   int32_t free_space_pointer =
@@ -261,23 +289,60 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
  */
 void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
                                LogManager *log_manager) {
+  int slot_num = rid.GetSlotNum();
+  assert(slot_num < GetTupleCount());
+  int32_t tuple_size = GetTupleSize(slot_num);
+
   if (ENABLE_LOGGING) {
     // must have already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
            txn->GetExclusiveLockSet()->end());
 
-    // TODO: add your logging logic here
+    Tuple delete_tuple;
+    delete_tuple.size_ = tuple_size < 0 ? -tuple_size : tuple_size;
+    delete_tuple.data_ = new char[delete_tuple.size_];
+    memcpy(delete_tuple.data_, GetData() + GetTupleOffset(slot_num),
+           delete_tuple.size_);
+    delete_tuple.rid_ = rid;
+    delete_tuple.allocated_ = true;
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::ROLLBACKDELETE, rid, delete_tuple);
+    lsn_t lsn = log_manager->AppendLogRecord(log_record);
+    txn->SetPrevLSN(lsn);
+    SetLSN(lsn);
   }
 
-  int slot_num = rid.GetSlotNum();
-  assert(slot_num < GetTupleCount());
-  int32_t tuple_size = GetTupleSize(slot_num);
-
   // set tuple size to positive value
   if (tuple_size < 0)
     SetTupleSize(slot_num, -tuple_size);
 }
 
+/*
+ * InsertTupleAt redoes an insert, or undoes an ApplyDelete, in the slot the
+ * log recorded. InsertTuple can not be used for that, it takes the first free
+ * slot, which is a different one if other slots were freed since
+ */
+bool TablePage::InsertTupleAt(const Tuple &tuple, const RID &rid) {
+  int slot_num = rid.GetSlotNum();
+  if (slot_num > GetTupleCount() ||
+      (slot_num < GetTupleCount() && GetTupleSize(slot_num) != 0)) {
+    return false;
+  }
+  int32_t needed = tuple.size_ + (slot_num == GetTupleCount() ? 8 : 0);
+  if (GetFreeSpaceSize() < needed) {
+    return false; // not enough space
+  }
+
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
+  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+  SetTupleOffset(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple.size_);
+  if (slot_num == GetTupleCount()) {
+    SetTupleCount(GetTupleCount() + 1);
+  }
+  return true;
+}
+
 bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
                          LockManager *lock_manager) {
   int slot_num = rid.GetSlotNum();
@@ -346,41 +411,41 @@ bool TablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
 
 // tuple slots
 int32_t TablePage::GetTupleOffset(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 24 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(GetData() + 28 + 8 * slot_num);
 }
 
 int32_t TablePage::GetTupleSize(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 28 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(GetData() + 32 + 8 * slot_num);
 }
 
 void TablePage::SetTupleOffset(int slot_num, int32_t offset) {
-  memcpy(GetData() + 24 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + 28 + 8 * slot_num, &offset, 4);
 }
 
 void TablePage::SetTupleSize(int slot_num, int32_t offset) {
-  memcpy(GetData() + 28 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + 32 + 8 * slot_num, &offset, 4);
 }
 
 // free space
 int32_t TablePage::GetFreeSpacePointer() {
-  return *reinterpret_cast<int32_t *>(GetData() + 16);
+  return *reinterpret_cast<int32_t *>(GetData() + 20);
 }
 
 void TablePage::SetFreeSpacePointer(int32_t free_space_pointer) {
-  memcpy(GetData() + 16, &free_space_pointer, 4);
+  memcpy(GetData() + 20, &free_space_pointer, 4);
 }
 
 // tuple count
 int32_t TablePage::GetTupleCount() {
-  return *reinterpret_cast<int32_t *>(GetData() + 20);
+  return *reinterpret_cast<int32_t *>(GetData() + 24);
 }
 
 void TablePage::SetTupleCount(int32_t tuple_count) {
-  memcpy(GetData() + 20, &tuple_count, 4);
+  memcpy(GetData() + 24, &tuple_count, 4);
 }
 
 // for free space calculation
 int32_t TablePage::GetFreeSpaceSize() {
-  return GetFreeSpacePointer() - 24 - GetTupleCount() * 8;
+  return GetFreeSpacePointer() - 28 - GetTupleCount() * 8;
 }
 } // namespace cmudb
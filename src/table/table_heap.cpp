@@ -19,22 +19,25 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
 // create table
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
+                     Transaction *txn, int extent_size)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
-      log_manager_(log_manager) {
-  auto first_page =
-      static_cast<TablePage *>(buffer_pool_manager_->NewPage(first_page_id_));
+      log_manager_(log_manager), extent_(extent_size) {
+  auto first_page = static_cast<TablePage *>(
+      buffer_pool_manager_->NewPage(first_page_id_, &extent_));
   assert(first_page != nullptr); // todo: abort table creation?
   first_page->WLatch();
   LOG_DEBUG("new table page created %d", first_page_id_);
 
-  first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
+  first_page->Init(first_page_id_, first_page->GetContentSize(), INVALID_LSN,
+                   log_manager_, txn);
   first_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) { // larger than one page size
+  // larger than one page size
+  if (tuple.size_ + 36 >
+      buffer_pool_manager_->GetPageSize() - PAGE_CHECKSUM_SIZE) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
@@ -58,8 +61,8 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
           buffer_pool_manager_->FetchPage(next_page_id));
       cur_page->WLatch();
     } else { // create new page
-      auto new_page =
-          static_cast<TablePage *>(buffer_pool_manager_->NewPage(next_page_id));
+      auto new_page = static_cast<TablePage *>(
+          buffer_pool_manager_->NewPage(next_page_id, &extent_));
       if (new_page == nullptr) {
         cur_page->WUnlatch();
         buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
@@ -70,8 +73,12 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
       // std::cout << "new table page " << next_page_id << " created" <<
       // std::endl;
       cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetPageId(),
-                     log_manager_, txn);
+      new_page->Init(next_page_id, new_page->GetContentSize(),
+                     cur_page->GetPageId(), log_manager_, txn);
+      if (ENABLE_LOGGING) {
+        // the NEWPAGE record covers the link to the new page as well
+        cur_page->SetLSN(new_page->GetLSN());
+      }
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
       cur_page = new_page;
@@ -140,9 +147,10 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
 }
 
 // called by tuple iterator
-bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
+bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                         BufferAccessStrategy *strategy) {
   auto page = static_cast<TablePage *>(
-      buffer_pool_manager_->FetchPage(rid.GetPageId()));
+      buffer_pool_manager_->FetchPage(rid.GetPageId(), strategy));
   if (page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
     return false;
@@ -159,9 +167,10 @@ bool TableHeap::DeleteTableHeap() {
   return true;
 }
 
-TableIterator TableHeap::begin(Transaction *txn) {
-  auto page =
-      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+TableIterator TableHeap::begin(Transaction *txn,
+                               BufferAccessStrategy *strategy) {
+  auto page = static_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(first_page_id_, strategy));
   page->RLatch();
   RID rid;
   // if failed (no tuple), rid will be the result of default
@@ -169,7 +178,7 @@ TableIterator TableHeap::begin(Transaction *txn) {
   page->GetFirstTupleRid(rid);
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, false);
-  return TableIterator(this, rid, txn);
+  return TableIterator(this, rid, txn, strategy);
 }
 
 TableIterator TableHeap::end() {
@@ -8,10 +8,15 @@
 
 namespace cmudb {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             BufferAccessStrategy *strategy)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn),
+      strategy_(strategy),
+      read_ahead_(strategy == nullptr
+                      ? table_heap->buffer_pool_manager_->GetReadAheadWindow()
+                      : 0) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_, strategy_);
   }
 };
 
@@ -28,20 +33,22 @@ Tuple *TableIterator::operator->() {
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
   auto cur_page = static_cast<TablePage *>(
-      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
+      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId(), strategy_));
   cur_page->RLatch();
   assert(cur_page != nullptr); // all pages are pinned
+  read_ahead_.Advance(buffer_pool_manager, cur_page->GetNextPageId());
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  next_tuple_rid)) { // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
       auto next_page = static_cast<TablePage *>(
-          buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+          buffer_pool_manager->FetchPage(cur_page->GetNextPageId(), strategy_));
       cur_page->RUnlatch();
       buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
       cur_page = next_page;
       cur_page->RLatch();
+      read_ahead_.Advance(buffer_pool_manager, cur_page->GetNextPageId());
       if (cur_page->GetFirstTupleRid(next_tuple_rid))
         break;
     }
@@ -49,7 +56,7 @@ TableIterator &TableIterator::operator++() {
   tuple_->rid_ = next_tuple_rid;
 
   if (*this != table_heap_->end()) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_, strategy_);
   }
   // release until copy the tuple
   cur_page->RUnlatch();
@@ -365,11 +365,16 @@ __declspec(dllexport)
   // create header page from BufferPoolManager if necessary
   if (!is_file_exist) {
     page_id_t header_page_id;
-    storage_engine_->buffer_pool_manager_->NewPage(header_page_id);
+    // formatted, so that checkpoints can be recorded before a table exists
+    auto header_page = static_cast<HeaderPage *>(
+        storage_engine_->buffer_pool_manager_->NewPage(header_page_id));
+    header_page->Init();
 
     assert(header_page_id == HEADER_PAGE_ID);
     storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
   }
+  // bound the log recovery has to read
+  storage_engine_->checkpoint_manager_->RunCheckpointThread();
 
   int rc = sqlite3_create_module(db, "vtable", &VtableModule, nullptr);
   return rc;
@@ -2,7 +2,17 @@
  * buffer_pool_manager_test.cpp
  */
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
@@ -48,4 +58,659 @@ TEST(BufferPoolManagerTest, SampleTest) {
   remove("test.db");
 }
 
+TEST(BufferPoolManagerTest, PartitionedTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(16, disk_manager, nullptr, 4);
+  EXPECT_EQ(4, bpm.GetNumInstances());
+
+  // page ids are spread round robin, so every instance gets 4 pages
+  for (int i = 0; i < 16; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, temp_page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+  }
+  // instance 0 is full now
+  EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(true, bpm.UnpinPage(i, true));
+  }
+  // evict everything and read it back
+  std::vector<page_id_t> new_pages;
+  for (int i = 0; i < 12; ++i) {
+    if (bpm.NewPage(temp_page_id) != nullptr) {
+      new_pages.push_back(temp_page_id);
+    }
+  }
+  for (auto page_id : new_pages) {
+    EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+  }
+  char expected[PAGE_SIZE];
+  for (int i = 0; i < 16; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+  EXPECT_EQ(true, bpm.AllPageUnpined());
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, AccessStrategyTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+  for (int i = 0; i < 30; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  // bring a hot set in, then scan twice as many pages as the pool holds
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_NE(nullptr, bpm.FetchPage(i));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+  BufferAccessStrategy strategy(3);
+  for (int i = 10; i < 30; ++i) {
+    EXPECT_NE(nullptr, bpm.FetchPage(i, &strategy));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+  // the scan only used 3 frames, the hot set is still there
+  size_t misses = bpm.GetNumMisses();
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_NE(nullptr, bpm.FetchPage(i));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+  EXPECT_EQ(misses, bpm.GetNumMisses());
+
+  // pinned ring frames are not reused, the ring takes shared frames instead
+  EXPECT_NE(nullptr, bpm.FetchPage(10, &strategy));
+  EXPECT_NE(nullptr, bpm.FetchPage(11, &strategy));
+  EXPECT_NE(nullptr, bpm.FetchPage(12, &strategy));
+  EXPECT_NE(nullptr, bpm.FetchPage(13, &strategy));
+  for (int i = 10; i < 14; ++i) {
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, CleanerTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager bpm(10, disk_manager, log_manager);
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    page->SetLSN(i);
+    snprintf(page->GetData() + 8, 16, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  // nothing is in the persistent log, the cleaner may not write any page
+  ENABLE_LOGGING = true;
+  bpm.RunCleanerThread(4);
+  std::this_thread::sleep_for(CLEANER_TIMEOUT * 5);
+  EXPECT_EQ(0, bpm.GetNumBackgroundWrites());
+  bpm.StopCleanerThread();
+  ENABLE_LOGGING = false;
+
+  // the cleaner writes the 4 least recently used pages and frees their frames
+  bpm.RunCleanerThread(4);
+  for (int i = 0; i < 1000 && bpm.GetNumBackgroundWrites() < 4; i++) {
+    std::this_thread::sleep_for(CLEANER_TIMEOUT);
+  }
+  bpm.StopCleanerThread();
+  EXPECT_EQ(4, bpm.GetNumBackgroundWrites());
+  for (int i = 10; i < 14; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+  }
+  EXPECT_EQ(0, bpm.GetNumForegroundWrites());
+
+  char buf[16];
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(buf, sizeof(buf), "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData() + 8, buf));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, FlushAllPagesTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(32, disk_manager, nullptr, 2);
+  // more pages than frames, some already went to disk as victims
+  for (int i = 0; i < 48; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  // dirty every other page again, keep a few of them pinned
+  for (int i = 16; i < 48; i += 2) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "new page %d", i);
+    if (i % 3 != 0) {
+      EXPECT_EQ(true, bpm.UnpinPage(i, true));
+    }
+  }
+
+  bpm.FlushAllPages();
+  size_t writes = bpm.GetNumForegroundWrites();
+  char data[PAGE_SIZE];
+  char buf[16];
+  for (int i = 0; i < 48; ++i) {
+    disk_manager->ReadPage(i, data);
+    snprintf(buf, sizeof(buf), i >= 16 && i % 2 == 0 ? "new page %d" : "page %d",
+             i);
+    EXPECT_EQ(0, strcmp(data, buf));
+  }
+  // nothing left to write
+  bpm.FlushAllPages();
+  EXPECT_EQ(writes, bpm.GetNumForegroundWrites());
+  for (int i = 18; i < 48; i += 6) {
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+  EXPECT_EQ(true, bpm.AllPageUnpined());
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+// flushing a pool full of dirty pages one page at a time vs all at once
+TEST(BufferPoolManagerTest, DISABLED_FlushAllPagesBenchmark) {
+  const int num_pages = 4096;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(num_pages, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_EQ(true, bpm.FlushPage(i));
+  }
+  disk_manager->SyncDB();
+  std::chrono::duration<double> page_by_page =
+      std::chrono::steady_clock::now() - start;
+
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_NE(nullptr, bpm.FetchPage(i));
+    EXPECT_EQ(true, bpm.UnpinPage(i, true));
+  }
+  start = std::chrono::steady_clock::now();
+  bpm.FlushAllPages();
+  std::chrono::duration<double> all_at_once =
+      std::chrono::steady_clock::now() - start;
+
+  std::cout << "FlushPage() x" << num_pages << " ms="
+            << page_by_page.count() * 1000 << std::endl;
+  std::cout << "FlushAllPages() ms=" << all_at_once.count() * 1000
+            << std::endl;
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+// frames are aligned for O_DIRECT, and pages survive being evicted to and read
+// back from a file opened with it
+TEST(BufferPoolManagerTest, DirectIOTest) {
+  const size_t pool_size = 16;
+  page_id_t page_id;
+  for (bool use_huge_pages : {false, true}) {
+    DiskManager::Options options;
+    options.direct_io = true;
+    DiskManager *disk_manager = new DiskManager("test.db", options);
+    BufferPoolManager *bpm =
+        new BufferPoolManager(pool_size, disk_manager, nullptr, 1,
+                              ReplacerType::LRU, use_huge_pages);
+    for (int i = 0; i < 64; ++i) {
+      Page *page = bpm->NewPage(page_id);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(page->GetData()) % PAGE_SIZE);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    }
+    for (int i = 0; i < 64; ++i) {
+      Page *page = bpm->FetchPage(i);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+      EXPECT_EQ(true, bpm->UnpinPage(i, false));
+    }
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+  }
+}
+
+// OS page cache pages holding the given file
+static size_t CachedBytes(const char *file_name) {
+  int fd = open(file_name, O_RDONLY);
+  off_t size = lseek(fd, 0, SEEK_END);
+  void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  long os_page = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> resident((size + os_page - 1) / os_page);
+  mincore(map, size, resident.data());
+  munmap(map, size);
+  close(fd);
+  size_t count = 0;
+  for (unsigned char r : resident) {
+    count += r & 1;
+  }
+  return count * os_page;
+}
+
+// random reads over a file much larger than the pool, buffered and with
+// O_DIRECT. A working set larger than RAM is not practical in a unit test,
+// instead the memory the OS spends caching the same pages a second time is
+// reported: with a working set larger than RAM, that memory would be taken
+// from the buffer pool
+TEST(BufferPoolManagerTest, DISABLED_DirectIOBenchmark) {
+  const int num_pages = 32768;
+  const size_t pool_size = 2048;
+  const int num_fetches = 50000;
+  {
+    DiskManager disk_manager("test.db");
+    std::vector<char> pages(num_pages * PAGE_SIZE, 1);
+    std::vector<const char *> run;
+    for (int i = 0; i < num_pages; i++) {
+      run.push_back(&pages[i * PAGE_SIZE]);
+    }
+    disk_manager.WritePages(0, run);
+    disk_manager.SyncDB();
+  }
+
+  for (bool direct_io : {false, true}) {
+    int fd = open("test.db", O_RDONLY);
+    ASSERT_LE(0, fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+
+    DiskManager::Options options;
+    options.direct_io = direct_io;
+    DiskManager *disk_manager = new DiskManager("test.db", options);
+    BufferPoolManager *bpm = new BufferPoolManager(pool_size, disk_manager);
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_fetches; i++) {
+      page_id_t page_id = dist(rng);
+      Page *page = bpm->FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(1, page->GetData()[0]);
+      bpm->UnpinPage(page_id, false);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (disk_manager->IsDirectIO() ? "O_DIRECT" : "buffered")
+              << " fetches/sec=" << static_cast<long>(num_fetches / elapsed.count())
+              << " hit ratio="
+              << static_cast<double>(bpm->GetNumHits()) / num_fetches
+              << " pool KB=" << pool_size * PAGE_SIZE / 1024
+              << " OS page cache KB=" << CachedBytes("test.db") / 1024
+              << std::endl;
+    delete bpm;
+    delete disk_manager;
+  }
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  for (int i = 0; i < 20; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+
+  // pages 0 - 4 were evicted, 15 is still in the pool, 20 was never written
+  bpm->PrefetchRange(0, 5);
+  bpm->Prefetch(15);
+  bpm->Prefetch(20);
+  for (int i = 0; i < 1000 && bpm->GetNumPrefetches() < 5; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(5, bpm->GetNumPrefetches());
+  EXPECT_EQ(true, bpm->AllPageUnpined());
+
+  size_t misses = bpm->GetNumMisses();
+  char buf[16];
+  for (int i = 0; i < 5; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(buf, sizeof(buf), "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), buf));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  EXPECT_EQ(misses, bpm->GetNumMisses());
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(5, bpm->GetNumPrefetches());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+// a page that fails its checksum makes FetchPage() throw, for every thread
+// fetching it at the same time, and does not keep a frame
+TEST(BufferPoolManagerTest, CorruptPageTest) {
+  const int num_threads = 8;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+  // page 1 is not in the pool any more
+  int fd = open("test.db", O_RDWR);
+  ASSERT_LE(0, fd);
+  char byte = '#';
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, PAGE_SIZE + 100));
+  close(fd);
+
+  // more threads than frames: a fetch that finds every frame busy with a
+  // failed read of the others gets no frame instead of the exception
+  std::atomic<int> num_errors(0), num_fetched(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 100; i++) {
+        try {
+          if (bpm->FetchPage(1) != nullptr) {
+            num_fetched++;
+          }
+        } catch (Exception &e) {
+          num_errors++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, num_fetched);
+  EXPECT_LT(0, num_errors);
+  // a prefetch of the page leaves nothing behind either
+  bpm->Prefetch(1);
+  for (int i = 0; i < 1000 && bpm->GetNumPrefetches() < 1; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_THROW(bpm->FetchPage(1), Exception);
+  EXPECT_EQ(true, bpm->AllPageUnpined());
+
+  // all frames are still there
+  char buf[16];
+  for (int i = 0; i < 8; ++i) {
+    if (i == 1) {
+      continue;
+    }
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(buf, sizeof(buf), "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), buf));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  // written again, the page can be fetched
+  char data[PAGE_SIZE] = {0};
+  snprintf(data, 16, "page %d", 1);
+  disk_manager->WritePage(1, data);
+  auto page = bpm->FetchPage(1);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp(page->GetData(), data));
+  EXPECT_EQ(true, bpm->UnpinPage(1, false));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+// a read only pool hands out the pages of the mapped db file, more at once
+// than it has frames, and never changes the files of the database
+TEST(BufferPoolManagerTest, ReadOnlyTest) {
+  const int num_pages = 8;
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.log");
+  DiskManager::Options options;
+  options.read_only = true;
+  EXPECT_THROW(DiskManager("test.db", options), Exception);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 16, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+  remove("test.log");
+  int fd = open("test.db", O_RDWR);
+  ASSERT_LE(0, fd);
+  char byte = '#';
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, 5 * PAGE_SIZE + 100));
+  close(fd);
+
+  disk_manager = new DiskManager("test.db", options);
+  EXPECT_EQ(true, disk_manager->IsReadOnly());
+  EXPECT_EQ(num_pages, disk_manager->GetNumPages());
+  bpm = new BufferPoolManager(4, disk_manager);
+  char buf[16];
+  for (int i = 0; i < num_pages; ++i) {
+    if (i == 5) {
+      EXPECT_THROW(bpm->FetchPage(i), Exception);
+      EXPECT_THROW(bpm->FetchPage(i), Exception);
+      continue;
+    }
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(disk_manager->GetMappedPage(i), page->GetData());
+    snprintf(buf, sizeof(buf), "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), buf));
+    EXPECT_EQ(page, bpm->FetchPage(i));
+    EXPECT_EQ(2, bpm->GetPagePinCount(i));
+  }
+  EXPECT_EQ(nullptr, bpm->FetchPage(num_pages));
+  EXPECT_EQ(nullptr, bpm->NewPage(page_id));
+  EXPECT_EQ(false, bpm->DeletePage(0));
+  EXPECT_EQ(false, bpm->AllPageUnpined());
+  for (int i = 0; i < num_pages; ++i) {
+    if (i != 5) {
+      EXPECT_EQ(true, bpm->UnpinPage(i, false));
+      EXPECT_EQ(true, bpm->UnpinPage(i, false));
+    }
+    EXPECT_EQ(false, bpm->UnpinPage(i, false));
+  }
+  EXPECT_EQ(true, bpm->AllPageUnpined());
+  bpm->PrefetchRange(0, num_pages * 2);
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+  EXPECT_NE(0, access("test.log", F_OK));
+  EXPECT_NE(0, access("test.fsm", F_OK));
+
+  remove("test.db");
+}
+
+// many more pages than frames, so most fetches miss and write back dirty
+// victims while other threads are hitting the same pages
+TEST(BufferPoolManagerTest, ConcurrentMissTest) {
+  const int num_pages = 200;
+  const int num_threads = 8;
+
+  for (size_t num_instances : {1, 4}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager bpm(16, disk_manager, nullptr, num_instances);
+    page_id_t temp_page_id;
+    for (int i = 0; i < num_pages; ++i) {
+      auto page = bpm.NewPage(temp_page_id);
+      ASSERT_NE(nullptr, page);
+      memcpy(page->GetData(), &temp_page_id, sizeof(page_id_t));
+      bpm.UnpinPage(temp_page_id, true);
+    }
+
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+      threads.push_back(std::thread([&bpm, tid]() {
+        std::mt19937 rng(tid);
+        std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+        for (int i = 0; i < 2000; i++) {
+          page_id_t page_id = dist(rng);
+          Page *page = bpm.FetchPage(page_id);
+          if (page == nullptr) {
+            // all frames pinned by the other threads
+            continue;
+          }
+          page->WLatch();
+          EXPECT_EQ(page_id, *reinterpret_cast<page_id_t *>(page->GetData()));
+          page->GetData()[sizeof(page_id_t)]++;
+          page->WUnlatch();
+          bpm.UnpinPage(page_id, i % 2 == 0);
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(true, bpm.AllPageUnpined());
+
+    delete disk_manager;
+    remove("test.db");
+  }
+}
+
+// latency of cache hits on a few hot pages while other threads keep missing
+TEST(BufferPoolManagerTest, DISABLED_HitLatencyUnderMissesBenchmark) {
+  const int num_hot_pages = 8;
+  const int num_cold_pages = 1000;
+  const int num_hits = 100000;
+
+  for (int num_missers : {0, 4}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager bpm(64, disk_manager);
+    page_id_t temp_page_id;
+    for (int i = 0; i < num_hot_pages + num_cold_pages; ++i) {
+      ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+      // hot pages stay pinned once so they are never evicted
+      if (i >= num_hot_pages) {
+        bpm.UnpinPage(temp_page_id, true);
+      }
+    }
+
+    std::atomic<bool> done(false);
+    std::vector<std::thread> missers;
+    for (int tid = 0; tid < num_missers; tid++) {
+      missers.push_back(std::thread([&bpm, &done, tid]() {
+        std::mt19937 rng(tid);
+        std::uniform_int_distribution<page_id_t> dist(
+            num_hot_pages, num_hot_pages + num_cold_pages - 1);
+        while (!done) {
+          page_id_t page_id = dist(rng);
+          if (bpm.FetchPage(page_id) != nullptr) {
+            bpm.UnpinPage(page_id, true);
+          }
+        }
+      }));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_hits; i++) {
+      page_id_t page_id = i % num_hot_pages;
+      EXPECT_NE(nullptr, bpm.FetchPage(page_id));
+      bpm.UnpinPage(page_id, false);
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    done = true;
+    for (auto &thread : missers) {
+      thread.join();
+    }
+    std::cout << "missing threads=" << num_missers << " avg hit latency(ns)="
+              << static_cast<long>(elapsed.count() / num_hits) << std::endl;
+
+    delete disk_manager;
+    remove("test.db");
+  }
+}
+
+// fetch/unpin throughput on a working set that fits in memory, so the only
+// shared state threads fight over is the buffer pool itself
+TEST(BufferPoolManagerTest, DISABLED_ConcurrentFetchBenchmark) {
+  const int pool_size = 512;
+  const int num_pages = 256;
+  const int total_ops = 200000;
+
+  for (size_t num_instances : {1, 16}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager bpm(pool_size, disk_manager, nullptr, num_instances);
+    page_id_t temp_page_id;
+    for (int i = 0; i < num_pages; ++i) {
+      ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+      bpm.UnpinPage(temp_page_id, true);
+    }
+
+    for (int num_threads : {1, 2, 4, 8, 16, 32}) {
+      std::vector<std::thread> threads;
+      auto start = std::chrono::steady_clock::now();
+      for (int tid = 0; tid < num_threads; tid++) {
+        threads.push_back(std::thread([&bpm, tid, num_threads]() {
+          std::mt19937 rng(tid);
+          std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+          for (int i = 0; i < total_ops / num_threads; i++) {
+            page_id_t page_id = dist(rng);
+            Page *page = bpm.FetchPage(page_id);
+            EXPECT_NE(nullptr, page);
+            bpm.UnpinPage(page_id, false);
+          }
+        }));
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::cout << "instances=" << num_instances << " threads=" << num_threads
+                << " ops/sec=" << static_cast<long>(total_ops / elapsed.count())
+                << std::endl;
+    }
+    EXPECT_EQ(true, bpm.AllPageUnpined());
+
+    delete disk_manager;
+    remove("test.db");
+  }
+}
+
 } // namespace cmudb
@@ -0,0 +1,142 @@
+/**
+ * clock_replacer_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ClockReplacerTest, SampleTest) {
+  ClockReplacer<int> clock_replacer(7);
+
+  // push element into replacer
+  clock_replacer.Insert(1);
+  clock_replacer.Insert(2);
+  clock_replacer.Insert(3);
+  clock_replacer.Insert(4);
+  clock_replacer.Insert(5);
+  clock_replacer.Insert(6);
+  clock_replacer.Insert(1);
+  EXPECT_EQ(6, clock_replacer.Size());
+
+  // the first sweep clears every reference bit, then frames go in hand order
+  int value;
+  clock_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+
+  // remove element from replacer
+  EXPECT_EQ(false, clock_replacer.Erase(3));
+  EXPECT_EQ(true, clock_replacer.Erase(6));
+  EXPECT_EQ(2, clock_replacer.Size());
+
+  // pop element from replacer after removal
+  clock_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+}
+
+TEST(ClockReplacerTest, SecondChanceTest) {
+  ClockReplacer<int> clock_replacer(4);
+  int value;
+
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+
+  clock_replacer.Insert(1);
+  clock_replacer.Insert(2);
+  clock_replacer.Insert(3);
+  EXPECT_EQ(true, clock_replacer.Victim(value));
+  EXPECT_EQ(1, value);
+
+  // 2 is referenced again, the hand skips it once
+  clock_replacer.Insert(2);
+  EXPECT_EQ(true, clock_replacer.Victim(value));
+  EXPECT_EQ(3, value);
+  EXPECT_EQ(true, clock_replacer.Victim(value));
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(0, clock_replacer.Size());
+
+  clock_replacer.Insert(0);
+  clock_replacer.Insert(0);
+  EXPECT_EQ(1, clock_replacer.Size());
+  EXPECT_EQ(true, clock_replacer.Erase(0));
+  EXPECT_EQ(false, clock_replacer.Erase(0));
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+}
+
+TEST(ClockReplacerTest, BufferPoolTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager, nullptr, 1, ReplacerType::CLOCK);
+
+  auto page_zero = bpm.NewPage(temp_page_id);
+  ASSERT_NE(nullptr, page_zero);
+  strcpy(page_zero->GetData(), "Hello");
+  for (int i = 1; i < 10; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+  }
+  EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(true, bpm.UnpinPage(i, true));
+  }
+  for (int i = 10; i < 14; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+  }
+  page_zero = bpm.FetchPage(0);
+  ASSERT_NE(nullptr, page_zero);
+  EXPECT_EQ(0, strcmp(page_zero->GetData(), "Hello"));
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+// the unpin/pin/evict mix the buffer pool generates, on every replacer
+template <typename R> double ReplacerOpsPerSecond(R &replacer, int num_frames) {
+  const int num_ops = 1000000;
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> dist(0, num_frames - 1);
+  for (int i = 0; i < num_frames; i++) {
+    replacer.Insert(i);
+  }
+  auto start = std::chrono::steady_clock::now();
+  int value;
+  for (int i = 0; i < num_ops; i += 3) {
+    replacer.Victim(value);
+    replacer.Insert(value);
+    int frame = dist(rng);
+    replacer.Erase(frame);
+    replacer.Insert(frame);
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return num_ops / elapsed.count();
+}
+
+TEST(ClockReplacerTest, DISABLED_ReplacerBenchmark) {
+  const int num_frames = 1024;
+  LRUReplacer<int> lru_replacer;
+  ClockReplacer<int> clock_replacer(num_frames);
+  std::cout << "LRUReplacer ops/sec="
+            << static_cast<long>(ReplacerOpsPerSecond(lru_replacer, num_frames))
+            << std::endl;
+  std::cout << "ClockReplacer ops/sec="
+            << static_cast<long>(
+                   ReplacerOpsPerSecond(clock_replacer, num_frames))
+            << std::endl;
+}
+
+} // namespace cmudb
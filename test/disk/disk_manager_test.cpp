@@ -0,0 +1,781 @@
+/**
+ * disk_manager_test.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <iostream>
+#include <random>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/crc32c.h"
+#include "disk/disk_manager.h"
+#include "page/header_page.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+void FillPage(char *data, page_id_t page_id) {
+  for (int i = 0; i < PAGE_SIZE; i++) {
+    data[i] = static_cast<char>(page_id * 31 + i);
+  }
+}
+
+// pages read back carry their checksum in the last bytes, only the rest is
+// what was written
+bool SamePages(const char *written, const char *read, int num_pages = 1) {
+  for (int i = 0; i < num_pages; i++) {
+    if (memcmp(written + i * PAGE_SIZE, read + i * PAGE_SIZE,
+               PAGE_SIZE - PAGE_CHECKSUM_SIZE) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int FileSize(const char *file_name) {
+  struct stat stat_buf;
+  return stat(file_name, &stat_buf) == 0 ? stat_buf.st_size : -1;
+}
+
+// many page writes and reads in flight at once, on both backends
+TEST(DiskManagerTest, AsyncReadWriteTest) {
+  const int num_pages = 256;
+  for (bool use_io_uring : {true, false}) {
+    DiskManager::Options options;
+    options.use_io_uring = use_io_uring;
+    DiskManager *disk_manager = new DiskManager("test.db", options);
+    std::vector<char> pages(num_pages * PAGE_SIZE);
+    std::vector<std::future<bool>> futures;
+    // written in reverse order, every write extends the file
+    for (int i = num_pages - 1; i >= 0; i--) {
+      FillPage(&pages[i * PAGE_SIZE], i);
+      futures.push_back(disk_manager->WritePageAsync(i, &pages[i * PAGE_SIZE]));
+    }
+    for (auto &future : futures) {
+      EXPECT_EQ(true, future.get());
+    }
+    EXPECT_EQ(num_pages, disk_manager->GetNumPages());
+
+    std::vector<char> read(num_pages * PAGE_SIZE);
+    std::atomic<int> num_read(0);
+    for (int i = 0; i < num_pages; i++) {
+      disk_manager->ReadPageAsync(i, &read[i * PAGE_SIZE], [&](bool ok) {
+        EXPECT_EQ(true, ok);
+        num_read++;
+      });
+    }
+    while (num_read < num_pages) {
+      std::this_thread::yield();
+    }
+    EXPECT_TRUE(SamePages(pages.data(), read.data(), num_pages));
+
+    // a page past the end of the file reads as zeros
+    char data[PAGE_SIZE];
+    memset(data, 1, PAGE_SIZE);
+    EXPECT_EQ(true, disk_manager->ReadPage(num_pages + 10, data));
+    for (int i = 0; i < PAGE_SIZE; i++) {
+      EXPECT_EQ(0, data[i]);
+    }
+    // synchronous calls see what asynchronous ones wrote and the other way
+    FillPage(data, 1000);
+    disk_manager->WritePage(7, data);
+    EXPECT_EQ(true, disk_manager->ReadPageAsync(7, &read[0]).get());
+    EXPECT_TRUE(SamePages(data, &read[0]));
+
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+// every byte depends on the page and on how often it was written, so a page
+// that got another page's data or an older version does not compare equal
+void FillPage(char *data, page_id_t page_id, int version) {
+  for (int i = 0; i < PAGE_SIZE; i++) {
+    data[i] = static_cast<char>(page_id * 31 + version * 7 + i);
+  }
+}
+
+// 32 threads read and write their own pages of one file at the same time,
+// every read has to give back exactly what the same thread wrote last
+TEST(DiskManagerTest, ConcurrentReadWriteTest) {
+  const int num_threads = 32;
+  const int pages_per_thread = 16;
+  const int num_ops = 2000;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::vector<std::vector<int>> versions(num_threads,
+                                         std::vector<int>(pages_per_thread));
+  std::atomic<int> num_errors(0);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      // pages of different threads are interleaved in the file
+      auto page_of = [t](int i) { return i * num_threads + t; };
+      std::mt19937 rng(t);
+      std::uniform_int_distribution<int> dist(0, pages_per_thread - 1);
+      char data[PAGE_SIZE], expected[PAGE_SIZE];
+      for (int i = 0; i < pages_per_thread; i++) {
+        FillPage(data, page_of(i), 0);
+        disk_manager->WritePage(page_of(i), data);
+      }
+      for (int op = 0; op < num_ops; op++) {
+        int i = dist(rng);
+        if (rng() % 2 == 0) {
+          FillPage(data, page_of(i), ++versions[t][i]);
+          disk_manager->WritePage(page_of(i), data);
+        }
+        bool ok = disk_manager->ReadPage(page_of(i), data);
+        FillPage(expected, page_of(i), versions[t][i]);
+        if (!ok || !SamePages(expected, data)) {
+          num_errors++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, num_errors);
+
+  // and the file holds the last version of every page
+  EXPECT_EQ(num_threads * pages_per_thread, disk_manager->GetNumPages());
+  char data[PAGE_SIZE], expected[PAGE_SIZE];
+  for (int t = 0; t < num_threads; t++) {
+    for (int i = 0; i < pages_per_thread; i++) {
+      page_id_t page_id = i * num_threads + t;
+      EXPECT_EQ(true, disk_manager->ReadPage(page_id, data));
+      FillPage(expected, page_id, versions[t][i]);
+      EXPECT_TRUE(SamePages(expected, data));
+    }
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// deallocated pages are handed out again, also after the db file is reopened,
+// and a reopened file never hands out a page that holds data
+TEST(DiskManagerTest, FreePageTest) {
+  const int num_pages = 200;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE];
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+    FillPage(data, i);
+    disk_manager->WritePage(i, data);
+  }
+  // lowest free page first
+  disk_manager->DeallocatePage(150);
+  disk_manager->DeallocatePage(7);
+  disk_manager->DeallocatePage(70);
+  disk_manager->DeallocatePage(70);
+  EXPECT_EQ(3u, disk_manager->GetNumFreePages());
+  EXPECT_EQ(7, disk_manager->AllocatePage());
+  EXPECT_EQ(2u, disk_manager->GetNumFreePages());
+  // allocated, never written: the id is free again after a restart
+  EXPECT_EQ(70, disk_manager->AllocatePage());
+  EXPECT_EQ(150, disk_manager->AllocatePage());
+  EXPECT_EQ(num_pages, disk_manager->AllocatePage());
+  disk_manager->DeallocatePage(70);
+  disk_manager->DeallocatePage(150);
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(2u, disk_manager->GetNumFreePages());
+  EXPECT_EQ(70, disk_manager->AllocatePage());
+  EXPECT_EQ(150, disk_manager->AllocatePage());
+  EXPECT_EQ(num_pages, disk_manager->AllocatePage());
+  EXPECT_EQ(num_pages + 1, disk_manager->AllocatePage());
+  disk_manager->DeallocatePage(3);
+  delete disk_manager;
+
+  // a new db file with a free space map left over from the old one
+  remove("test.db");
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0u, disk_manager->GetNumFreePages());
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+    disk_manager->WritePage(i, data);
+  }
+  delete disk_manager;
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0u, disk_manager->GetNumFreePages());
+  EXPECT_EQ(num_pages, disk_manager->AllocatePage());
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+// a db file past 2 GiB, sparse so that it takes no room: the page count of a
+// reopened database has to cover all of it, the next page comes after it
+TEST(DiskManagerTest, LargeFileTest) {
+  const off_t file_size = (1ll << 31) + 2 * PAGE_SIZE;
+  page_id_t num_pages = file_size / PAGE_SIZE;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE], read[PAGE_SIZE];
+  FillPage(data, 0);
+  disk_manager->WritePage(disk_manager->AllocatePage(), data);
+  delete disk_manager;
+  ASSERT_EQ(0, truncate("test.db", file_size));
+
+  for (bool read_only : {false, true}) {
+    DiskManager::Options options;
+    options.read_only = read_only;
+    disk_manager = new DiskManager("test.db", options);
+    EXPECT_EQ(num_pages, disk_manager->GetNumPages());
+    EXPECT_TRUE(disk_manager->ReadPage(0, read));
+    EXPECT_TRUE(SamePages(data, read));
+    if (!read_only) {
+      EXPECT_EQ(num_pages, disk_manager->AllocatePage());
+      FillPage(data, num_pages);
+      disk_manager->WritePage(num_pages, data);
+      EXPECT_TRUE(disk_manager->ReadPage(num_pages, read));
+      EXPECT_TRUE(SamePages(data, read));
+      FillPage(data, 0);
+      num_pages++;
+    }
+    delete disk_manager;
+  }
+
+  remove("test.db");
+  DiskManager::RemoveLogFiles("test.db");
+  remove("test.fsm");
+}
+
+// a database keeps the page size it was created with, whatever page size it
+// is reopened with
+TEST(DiskManagerTest, PageSizeTest) {
+  const int page_size = 4096;
+  DiskManager::Options options;
+  options.page_size = 1000;
+  EXPECT_THROW(DiskManager("test.db", options), Exception);
+  options.page_size = MAX_PAGE_SIZE * 2;
+  EXPECT_THROW(DiskManager("test.db", options), Exception);
+  remove("test.db");
+
+  options.page_size = page_size;
+  DiskManager *disk_manager = new DiskManager("test.db", options);
+  BufferPoolManager *bpm = new BufferPoolManager(8, disk_manager);
+  EXPECT_EQ(page_size, bpm->GetPageSize());
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  EXPECT_EQ(HEADER_PAGE_ID, page_id);
+  EXPECT_EQ(page_size, header_page->GetPageSize());
+  EXPECT_EQ(true, header_page->InsertRecord("foo", 1));
+  bpm->UnpinPage(page_id, true);
+  Page *page = bpm->NewPage(page_id);
+  memset(page->GetData(), 'x', page_size);
+  bpm->UnpinPage(page_id, true);
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(page_size, disk_manager->GetPageSize());
+  EXPECT_EQ(2, disk_manager->GetNumPages());
+  bpm = new BufferPoolManager(8, disk_manager);
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  page_id_t root_id;
+  EXPECT_EQ(true, header_page->GetRootId("foo", root_id));
+  EXPECT_EQ(1, root_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  page = bpm->FetchPage(1);
+  EXPECT_EQ('x', page->GetData()[page->GetContentSize() - 1]);
+  bpm->UnpinPage(1, false);
+  delete bpm;
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// with O_DIRECT, buffers that are not PAGE_SIZE aligned still work, through a
+// copy, and buffered I/O on the same file sees the same pages
+TEST(DiskManagerTest, DirectIOTest) {
+  const int num_pages = 64;
+  DiskManager::Options options;
+  options.direct_io = true;
+  DiskManager *disk_manager = new DiskManager("test.db", options);
+  std::vector<char> pages(num_pages * PAGE_SIZE + 1);
+  // odd address, never aligned
+  char *unaligned = pages.data() + 1;
+  for (int i = 0; i < num_pages; i++) {
+    FillPage(unaligned + i * PAGE_SIZE, i);
+  }
+  std::vector<const char *> run;
+  for (int i = 0; i < num_pages / 2; i++) {
+    run.push_back(unaligned + i * PAGE_SIZE);
+  }
+  disk_manager->WritePages(0, run);
+  for (int i = num_pages / 2; i < num_pages; i++) {
+    if (i % 2 == 0) {
+      disk_manager->WritePage(i, unaligned + i * PAGE_SIZE);
+    } else {
+      EXPECT_EQ(true,
+                disk_manager->WritePageAsync(i, unaligned + i * PAGE_SIZE).get());
+    }
+  }
+
+  alignas(PAGE_SIZE) char aligned[PAGE_SIZE];
+  std::vector<char> read(PAGE_SIZE + 1);
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(true, disk_manager->ReadPage(i, aligned));
+    EXPECT_TRUE(SamePages(unaligned + i * PAGE_SIZE, aligned));
+    EXPECT_EQ(true, disk_manager->ReadPageAsync(i, read.data() + 1).get());
+    EXPECT_TRUE(SamePages(unaligned + i * PAGE_SIZE, read.data() + 1));
+  }
+  // past the end of the file
+  disk_manager->ReadPage(num_pages, read.data() + 1);
+  EXPECT_EQ(std::vector<char>(PAGE_SIZE), std::vector<char>(read.begin() + 1, read.end()));
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(true, disk_manager->ReadPage(i, aligned));
+    EXPECT_TRUE(SamePages(unaligned + i * PAGE_SIZE, aligned));
+  }
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a page changed on disk behind the disk manager's back, or only partly
+// written, fails its checksum. A page that was never written does not
+TEST(DiskManagerTest, ChecksumTest) {
+  // known answer of CRC-32C, in one piece and continued
+  EXPECT_EQ(0xE3069283u, Crc32c("123456789", 9));
+  EXPECT_EQ(0xE3069283u, Crc32c("6789", 4, Crc32c("12345", 5)));
+  // against a bit at a time, long enough for every path of Crc32c()
+  std::vector<char> buffer(10000);
+  std::mt19937 rng(0);
+  for (auto &byte : buffer) {
+    byte = static_cast<char>(rng());
+  }
+  for (size_t len : {0, 7, 100, 767, 768, 4092, 10000}) {
+    uint32_t expected = ~0u;
+    for (size_t i = 0; i < len; i++) {
+      expected ^= static_cast<uint8_t>(buffer[i]);
+      for (int bit = 0; bit < 8; bit++) {
+        expected = (expected >> 1) ^ (expected & 1 ? 0x82F63B78 : 0);
+      }
+    }
+    EXPECT_EQ(~expected, Crc32c(buffer.data(), len));
+  }
+
+  const int num_pages = 4;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE], read[PAGE_SIZE];
+  for (int i = 0; i < num_pages; i++) {
+    FillPage(data, i);
+    disk_manager->WritePage(i, data);
+    EXPECT_EQ(true, disk_manager->ReadPage(i, read));
+  }
+  int fd = open("test.db", O_RDWR);
+  ASSERT_LE(0, fd);
+
+  // one flipped bit
+  char byte;
+  ASSERT_EQ(1, pread(fd, &byte, 1, PAGE_SIZE + 100));
+  byte ^= 4;
+  ASSERT_EQ(1, pwrite(fd, &byte, 1, PAGE_SIZE + 100));
+  EXPECT_EQ(false, disk_manager->ReadPage(1, read));
+  EXPECT_EQ(false, disk_manager->ReadPageAsync(1, read).get());
+  // written again, it is fine
+  FillPage(data, 1);
+  disk_manager->WritePage(1, data);
+  EXPECT_EQ(true, disk_manager->ReadPage(1, read));
+
+  // torn write: the first half of a new version over the old page
+  FillPage(data, 2, 1);
+  ASSERT_EQ(PAGE_SIZE / 2, pwrite(fd, data, PAGE_SIZE / 2, 2 * PAGE_SIZE));
+  EXPECT_EQ(false, disk_manager->ReadPage(2, read));
+
+  // the file ends in the middle of the last page
+  ASSERT_EQ(0, ftruncate(fd, (num_pages - 1) * PAGE_SIZE + PAGE_SIZE / 2));
+  EXPECT_EQ(false, disk_manager->ReadPage(num_pages - 1, read));
+
+  // a page written to the offset of another one, with its own checksum
+  ASSERT_EQ(PAGE_SIZE, pread(fd, data, PAGE_SIZE, 0));
+  ASSERT_EQ(PAGE_SIZE, pwrite(fd, data, PAGE_SIZE, PAGE_SIZE));
+  EXPECT_EQ(false, disk_manager->ReadPage(1, read));
+  EXPECT_EQ(true, disk_manager->ReadPage(0, read));
+
+  // zeros inside the file were a page once, past its end never
+  memset(data, 0, PAGE_SIZE);
+  ASSERT_EQ(PAGE_SIZE, pwrite(fd, data, PAGE_SIZE, PAGE_SIZE));
+  EXPECT_EQ(false, disk_manager->ReadPage(1, read));
+  EXPECT_EQ(false, disk_manager->ReadPageAsync(1, read).get());
+  EXPECT_EQ(true, disk_manager->ReadPage(num_pages + 10, read));
+  EXPECT_EQ(true, disk_manager->ReadPageAsync(num_pages + 10, read).get());
+  close(fd);
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a compressed database: pages that compress and pages that do not, written
+// and read every way, kept where the page map says after reopening, rewritten
+// in the space they free, and given back to the file system when freed
+TEST(DiskManagerTest, CompressionTest) {
+  const int num_pages = 16;
+  remove("test.db");
+  remove("test.map");
+  DiskManager::Options options;
+  options.direct_io = true;
+  options.compress = true;
+  DiskManager *disk_manager = new DiskManager("test.db", options);
+  EXPECT_EQ(true, disk_manager->IsCompressed());
+  EXPECT_EQ(false, disk_manager->IsDirectIO());
+  std::vector<char> pages(num_pages * PAGE_SIZE);
+  std::mt19937 rng(0);
+  for (int i = 0; i < num_pages; i++) {
+    if (i % 2 == 0) {
+      FillPage(&pages[i * PAGE_SIZE], i);
+    } else {
+      for (int j = 0; j < PAGE_SIZE; j++) {
+        pages[i * PAGE_SIZE + j] = static_cast<char>(rng());
+      }
+    }
+  }
+  std::vector<const char *> run;
+  for (int i = 0; i < num_pages / 2; i++) {
+    run.push_back(&pages[i * PAGE_SIZE]);
+  }
+  disk_manager->WritePages(0, run);
+  for (int i = num_pages / 2; i < num_pages; i++) {
+    if (i % 4 < 2) {
+      disk_manager->WritePage(i, &pages[i * PAGE_SIZE]);
+    } else {
+      EXPECT_EQ(true,
+                disk_manager->WritePageAsync(i, &pages[i * PAGE_SIZE]).get());
+    }
+  }
+  disk_manager->SyncDB();
+  size_t bytes_written = disk_manager->GetNumBytesWritten();
+  EXPECT_GT(static_cast<size_t>(num_pages * PAGE_SIZE), bytes_written);
+  EXPECT_LT(static_cast<size_t>(num_pages / 2 * PAGE_SIZE), bytes_written);
+  int file_size = FileSize("test.db");
+  EXPECT_GT(num_pages * PAGE_SIZE, file_size);
+
+  char read[PAGE_SIZE];
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(true, disk_manager->ReadPage(i, read));
+    EXPECT_TRUE(SamePages(&pages[i * PAGE_SIZE], read));
+    memset(read, 0, PAGE_SIZE);
+    EXPECT_EQ(true, disk_manager->ReadPageAsync(i, read).get());
+    EXPECT_TRUE(SamePages(&pages[i * PAGE_SIZE], read));
+  }
+  // never written
+  EXPECT_EQ(true, disk_manager->ReadPage(num_pages + 1, read));
+  EXPECT_EQ(std::vector<char>(PAGE_SIZE), std::vector<char>(read, read + PAGE_SIZE));
+  delete disk_manager;
+
+  // the page size comes from the page map, the compress flag only matters for
+  // a new database
+  options = DiskManager::Options();
+  options.page_size = 2 * PAGE_SIZE;
+  disk_manager = new DiskManager("test.db", options);
+  EXPECT_EQ(true, disk_manager->IsCompressed());
+  EXPECT_EQ(PAGE_SIZE, disk_manager->GetPageSize());
+  EXPECT_EQ(num_pages, disk_manager->GetNumPages());
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(true, disk_manager->ReadPage(i, read));
+    EXPECT_TRUE(SamePages(&pages[i * PAGE_SIZE], read));
+  }
+  // rewrites take the sectors earlier versions left once the map is synced:
+  // after ten rounds the file is about as large as after one, not ten times
+  // as large
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < num_pages; i++) {
+      disk_manager->WritePage(i, &pages[i * PAGE_SIZE]);
+    }
+    disk_manager->SyncDB();
+  }
+  EXPECT_GE(file_size + file_size / 4, FileSize("test.db"));
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(true, disk_manager->ReadPage(i, read));
+    EXPECT_TRUE(SamePages(&pages[i * PAGE_SIZE], read));
+  }
+
+  // a crash before the map is synced leaves the synced map, whose entry
+  // still has to find the old version of a rewritten page, not one of the
+  // pages written since, enough of them to fill every free sector
+  int map_fd = open("test.map", O_RDWR);
+  ASSERT_LE(0, map_fd);
+  std::vector<char> synced_map(FileSize("test.map"));
+  ASSERT_EQ(static_cast<ssize_t>(synced_map.size()),
+            pread(map_fd, synced_map.data(), synced_map.size(), 0));
+  char data[PAGE_SIZE];
+  FillPage(data, num_pages);
+  disk_manager->WritePage(0, data);
+  for (int i = num_pages; i < num_pages * 8; i++) {
+    FillPage(data, i);
+    disk_manager->WritePage(i, data);
+  }
+  delete disk_manager;
+  ASSERT_EQ(static_cast<ssize_t>(synced_map.size()),
+            pwrite(map_fd, synced_map.data(), synced_map.size(), 0));
+  ASSERT_EQ(0, ftruncate(map_fd, synced_map.size()));
+  close(map_fd);
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(true, disk_manager->ReadPage(0, read));
+  EXPECT_TRUE(SamePages(&pages[0], read));
+
+  // garbage in place of every page, compressed or not
+  int fd = open("test.db", O_RDWR);
+  ASSERT_LE(0, fd);
+  std::vector<char> garbage(FileSize("test.db"), 0x55);
+  ASSERT_EQ(static_cast<ssize_t>(garbage.size()),
+            pwrite(fd, garbage.data(), garbage.size(), 0));
+  close(fd);
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(false, disk_manager->ReadPage(i, read));
+    EXPECT_EQ(false, disk_manager->ReadPageAsync(i, read).get());
+  }
+
+  // freed pages read as zeros and leave the file
+  for (int i = 0; i < num_pages; i++) {
+    disk_manager->DeallocatePage(i);
+  }
+  disk_manager->SyncDB();
+  EXPECT_EQ(0, FileSize("test.db"));
+  EXPECT_EQ(true, disk_manager->ReadPage(0, read));
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.map");
+  remove("test.log");
+}
+
+// log writes and reads across segment files, discarded segments recycled
+// and archived, and a truncated log reopened
+TEST(DiskManagerTest, LogSegmentTest) {
+  const int segment_size = 4096;
+  const int write_size = 3000;
+  DiskManager::RemoveLogFiles("test.db");
+  DiskManager::Options options;
+  options.log_segment_size = segment_size;
+  DiskManager *disk_manager = new DiskManager("test.db", options);
+  EXPECT_EQ(0, disk_manager->GetLogSize());
+  EXPECT_NE(0, access("test.log.0000000000000000", F_OK));
+
+  // the log manager alternates two buffers
+  std::vector<char> log(8 * write_size);
+  for (size_t i = 0; i < log.size(); i++) {
+    log[i] = static_cast<char>(i * 7 + i / 251);
+  }
+  char buffers[2][write_size];
+  for (int i = 0; i < 5; i++) {
+    memcpy(buffers[i % 2], log.data() + i * write_size, write_size);
+    disk_manager->WriteLog(buffers[i % 2], write_size);
+  }
+  EXPECT_EQ(5 * write_size, disk_manager->GetLogSize());
+  // segments are preallocated whole
+  for (const char *name : {"test.log.0000000000000000",
+                           "test.log.0000000000000003"}) {
+    EXPECT_EQ(segment_size, FileSize(name));
+  }
+  std::vector<char> read(5 * write_size + 100);
+  EXPECT_TRUE(disk_manager->ReadLog(read.data(), read.size(), 0));
+  EXPECT_EQ(0, memcmp(log.data(), read.data(), 5 * write_size));
+  // past the end of the log reads as zeros
+  EXPECT_EQ(0, read[5 * write_size + 50]);
+  EXPECT_TRUE(disk_manager->ReadLog(read.data(), 200, segment_size - 100));
+  EXPECT_EQ(0, memcmp(log.data() + segment_size - 100, read.data(), 200));
+  EXPECT_FALSE(disk_manager->ReadLog(read.data(), 100, 5 * write_size));
+
+  // segments 0 and 1 become spare segments, the next new segment is one
+  disk_manager->DiscardLogBefore(3 * segment_size - 1);
+  EXPECT_EQ(2 * segment_size, disk_manager->GetLogStart());
+  EXPECT_FALSE(disk_manager->ReadLog(read.data(), 100, 0));
+  EXPECT_NE(0, access("test.log.0000000000000001", F_OK));
+  EXPECT_EQ(0, access("test.log.spare0000000000000000", F_OK));
+  EXPECT_EQ(0, access("test.log.spare0000000000000001", F_OK));
+  memcpy(buffers[1], log.data() + 5 * write_size, write_size);
+  disk_manager->WriteLog(buffers[1], write_size);
+  EXPECT_EQ(segment_size, FileSize("test.log.0000000000000004"));
+  EXPECT_NE(0, access("test.log.spare0000000000000001", F_OK));
+  EXPECT_TRUE(disk_manager->ReadLog(read.data(), 3 * write_size,
+                                    3 * write_size));
+  EXPECT_EQ(0, memcmp(log.data() + 3 * write_size, read.data(),
+                      3 * write_size));
+  delete disk_manager;
+
+  // reopened, the log continues in a new segment until it is truncated
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(segment_size, disk_manager->GetLogSegmentSize());
+  EXPECT_EQ(2 * segment_size, disk_manager->GetLogStart());
+  EXPECT_EQ(5 * segment_size, disk_manager->GetLogSize());
+  disk_manager->TruncateLog(5 * write_size);
+  EXPECT_EQ(5 * write_size, disk_manager->GetLogSize());
+  EXPECT_NE(0, access("test.log.0000000000000004", F_OK));
+  EXPECT_TRUE(disk_manager->ReadLog(read.data(), write_size,
+                                    5 * write_size - 100));
+  EXPECT_EQ(0, memcmp(log.data() + 5 * write_size - 100, read.data(), 100));
+  EXPECT_EQ(0, read[100]);
+
+  // with an archive directory, discarded segments are moved there
+  mkdir("test_archive", 0755);
+  disk_manager->SetLogArchiveDirectory("test_archive");
+  disk_manager->DiscardLogBefore(5 * write_size);
+  EXPECT_EQ(3 * segment_size, disk_manager->GetLogStart());
+  EXPECT_EQ(segment_size, FileSize("test_archive/test.log.0000000000000002"));
+  EXPECT_NE(0, access("test.log.0000000000000002", F_OK));
+  delete disk_manager;
+
+  remove("test_archive/test.log.0000000000000002");
+  rmdir("test_archive");
+  remove("test.db");
+  DiskManager::RemoveLogFiles("test.db");
+}
+
+// reading a file that is not in the OS page cache one page at a time vs
+// with IO_QUEUE_DEPTH reads in flight
+TEST(DiskManagerTest, DISABLED_QueueDepthBenchmark) {
+  const int num_pages = 8192;
+  for (bool use_io_uring : {true, false}) {
+    DiskManager::Options options;
+    options.use_io_uring = use_io_uring;
+    DiskManager *disk_manager = new DiskManager("test.db", options);
+    std::vector<char> pages(num_pages * PAGE_SIZE);
+    for (int i = 0; i < num_pages; i++) {
+      FillPage(&pages[i * PAGE_SIZE], i);
+    }
+    std::vector<const char *> run;
+    for (int i = 0; i < num_pages; i++) {
+      run.push_back(&pages[i * PAGE_SIZE]);
+    }
+    disk_manager->WritePages(0, run);
+    disk_manager->SyncDB();
+
+    for (int depth : {1, IO_QUEUE_DEPTH}) {
+      int fd = open("test.db", O_RDONLY);
+      ASSERT_LE(0, fd);
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+
+      std::vector<char> read(num_pages * PAGE_SIZE);
+      std::atomic<int> num_read(0);
+      auto start = std::chrono::steady_clock::now();
+      // pages are spread over the file so that neither the disk nor the OS
+      // read ahead turns the reads into one sequential stream
+      for (int i = 0; i < num_pages; i++) {
+        page_id_t page_id = (i * 4099) % num_pages;
+        while (i - num_read >= depth) {
+          std::this_thread::yield();
+        }
+        disk_manager->ReadPageAsync(page_id, &read[page_id * PAGE_SIZE],
+                                    [&](bool ok) { num_read++; });
+      }
+      while (num_read < num_pages) {
+        std::this_thread::yield();
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      EXPECT_TRUE(SamePages(pages.data(), read.data(), num_pages));
+      std::cout << disk_manager->GetIOBackendName() << " in flight=" << depth
+                << " pages/sec=" << static_cast<long>(num_pages / elapsed.count())
+                << std::endl;
+    }
+
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+// what the checksum adds to a page read: CRC32C of a page vs reading it
+// (checksum included) from the OS page cache and from the device, with
+// O_DIRECT where the file system supports it
+TEST(DiskManagerTest, DISABLED_ChecksumBenchmark) {
+  const int num_pages = 2048;
+  const int rounds = 20;
+  std::cout << "crc32c in hardware: " << Crc32cIsHardware() << std::endl;
+  std::mt19937 rng(0);
+  for (int page_size : {PAGE_SIZE, 4096, 16384}) {
+    remove("test.db");
+    DiskManager::Options options;
+    options.use_io_uring = false;
+    options.page_size = page_size;
+    DiskManager *disk_manager = new DiskManager("test.db", options);
+    std::vector<char> pages(num_pages * page_size);
+    for (auto &byte : pages) {
+      byte = static_cast<char>(rng());
+    }
+    std::vector<const char *> run;
+    for (int i = 0; i < num_pages; i++) {
+      run.push_back(&pages[i * page_size]);
+    }
+    disk_manager->WritePages(0, run);
+    disk_manager->SyncDB();
+
+    // a read checksums the page it just copied, in the CPU cache like the
+    // few pages cycled through here. A call into another translation unit,
+    // the compiler can not drop it
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < num_pages; i++) {
+        Crc32c(&pages[(i % 8) * page_size], page_size - PAGE_CHECKSUM_SIZE);
+      }
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double checksum_ns = elapsed.count() / (rounds * num_pages);
+
+    std::vector<char> read(page_size);
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < num_pages; i++) {
+        EXPECT_EQ(true, disk_manager->ReadPage(i, read.data()));
+      }
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    double cached_ns = elapsed.count() / (rounds * num_pages);
+    delete disk_manager;
+
+    int fd = open("test.db", O_RDONLY);
+    ASSERT_LE(0, fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    // no header page records the page size
+    options.direct_io = true;
+    disk_manager = new DiskManager("test.db", options);
+    char *aligned = static_cast<char *>(aligned_alloc(page_size, page_size));
+    start = std::chrono::steady_clock::now();
+    // spread over the file, so that no read ahead helps
+    for (int i = 0; i < num_pages; i++) {
+      EXPECT_EQ(true,
+                disk_manager->ReadPage((i * 4099) % num_pages, aligned));
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    double device_ns = elapsed.count() / num_pages;
+    free(aligned);
+
+    std::cout << "page size=" << page_size << " crc32c ns=" << static_cast<long>(checksum_ns)
+              << " cached read ns=" << static_cast<long>(cached_ns) << " ("
+              << static_cast<int>(100 * checksum_ns / cached_ns) << "%)"
+              << " device read ns=" << static_cast<long>(device_ns) << " ("
+              << 100 * checksum_ns / device_ns << "%, direct I/O "
+              << disk_manager->IsDirectIO() << ")" << std::endl;
+    delete disk_manager;
+  }
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -2,8 +2,16 @@
  * extendible_hash_test.cpp
  */
 
+#include <chrono>
+#include <iostream>
+#include <random>
 #include <thread>
+#include <unordered_map>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
+#include "common/config.h"
 #include "hash/extendible_hash.h"
 #include "gtest/gtest.h"
 
@@ -102,4 +110,76 @@ TEST(ExtendibleHashTest, ConcurrentRemoveTest) {
   }
 }
 
+// random inserts/overwrites/removes against std::unordered_map, with small
+// buckets so that splits and holes left by removes happen all the time
+TEST(ExtendibleHashTest, RandomOperationTest) {
+  ExtendibleHash<int, std::string> test(4);
+  std::unordered_map<int, std::string> reference;
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> dist(0, 999);
+  std::string result;
+  for (int i = 0; i < 20000; i++) {
+    int key = dist(rng);
+    switch (rng() % 3) {
+    case 0:
+      test.Insert(key, std::to_string(i));
+      reference[key] = std::to_string(i);
+      break;
+    case 1:
+      EXPECT_EQ(reference.erase(key) == 1, test.Remove(key));
+      break;
+    default:
+      bool found = reference.count(key) == 1;
+      EXPECT_EQ(found, test.Find(key, result));
+      if (found) {
+        EXPECT_EQ(reference[key], result);
+      }
+    }
+  }
+  for (auto &item : reference) {
+    EXPECT_EQ(true, test.Find(item.first, result));
+    EXPECT_EQ(item.second, result);
+  }
+}
+
+static inline unsigned long long ReadCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// cost of one Find() on a table with a few thousand buckets, half of the
+// lookups miss
+TEST(ExtendibleHashTest, DISABLED_LookupBenchmark) {
+  const int num_keys = 100000;
+  const int num_lookups = 2000000;
+  ExtendibleHash<int, int> test(BUCKET_SIZE);
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> dist(0, 1 << 30);
+  std::vector<int> keys;
+  for (int i = 0; i < num_keys; i++) {
+    keys.push_back(dist(rng));
+    test.Insert(keys.back(), i);
+  }
+  std::vector<int> lookups;
+  for (int i = 0; i < num_lookups; i++) {
+    lookups.push_back(i % 2 == 0 ? keys[rng() % num_keys] : dist(rng));
+  }
+
+  int val, found = 0;
+  auto start = std::chrono::steady_clock::now();
+  unsigned long long start_cycles = ReadCycles();
+  for (int key : lookups) {
+    found += test.Find(key, val);
+  }
+  unsigned long long cycles = ReadCycles() - start_cycles;
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  EXPECT_LE(num_lookups / 2, found);
+  std::cout << "ns/lookup=" << elapsed.count() / num_lookups
+            << " cycles/lookup=" << cycles / num_lookups << std::endl;
+}
+
 } // namespace cmudb
@@ -0,0 +1,165 @@
+/**
+ * open_address_hash_test.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+#include "common/exception.h"
+#include "hash/extendible_hash.h"
+#include "hash/open_address_hash.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(OpenAddressHashTest, SampleTest) {
+  OpenAddressHash<int, int> *test = new OpenAddressHash<int, int>(16);
+  EXPECT_EQ(32, test->GetCapacity());
+
+  // insert several key/value pairs
+  for (int i = 0; i < 16; i++) {
+    test->Insert(i, i * 10);
+  }
+  EXPECT_THROW(test->Insert(16, 160), Exception);
+
+  int result;
+  for (int i = 0; i < 16; i++) {
+    EXPECT_EQ(1, test->Find(i, result));
+    EXPECT_EQ(i * 10, result);
+  }
+  EXPECT_EQ(0, test->Find(16, result));
+
+  // overwrite and delete
+  test->Insert(3, 33);
+  test->Find(3, result);
+  EXPECT_EQ(33, result);
+  EXPECT_EQ(1, test->Remove(3));
+  EXPECT_EQ(0, test->Remove(3));
+  EXPECT_EQ(0, test->Find(3, result));
+  test->Insert(16, 160);
+  EXPECT_EQ(1, test->Find(16, result));
+  EXPECT_EQ(160, result);
+
+  delete test;
+}
+
+// keys colliding on a long probe chain stay reachable while the chain is
+// punched full of holes and refilled
+TEST(OpenAddressHashTest, ProbeChainTest) {
+  const int num_keys = 100;
+  OpenAddressHash<int, int> test(num_keys);
+  int result;
+
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < num_keys; i++) {
+      test.Insert(round * num_keys + i, i);
+    }
+    for (int i = 0; i < num_keys; i += 2) {
+      EXPECT_EQ(1, test.Remove(round * num_keys + i));
+    }
+    for (int i = 0; i < num_keys; i++) {
+      EXPECT_EQ(i % 2 == 1, test.Find(round * num_keys + i, result));
+    }
+    for (int i = 1; i < num_keys; i += 2) {
+      EXPECT_EQ(1, test.Remove(round * num_keys + i));
+    }
+  }
+  EXPECT_EQ(0, test.Find(0, result));
+}
+
+// readers never see a key with a value that was not inserted for it
+TEST(OpenAddressHashTest, ConcurrentTest) {
+  const int num_keys = 64;
+  OpenAddressHash<int, int> test(num_keys);
+  for (int i = 0; i < num_keys / 2; i++) {
+    test.Insert(i, i * 2 + 1);
+  }
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < 4; tid++) {
+    readers.push_back(std::thread([&test, &done, tid]() {
+      std::mt19937 rng(tid);
+      std::uniform_int_distribution<int> dist(0, num_keys - 1);
+      int result;
+      while (!done) {
+        int key = dist(rng);
+        if (test.Find(key, result)) {
+          EXPECT_EQ(key * 2 + 1, result);
+        }
+        // never removed
+        if (key < num_keys / 4) {
+          EXPECT_EQ(1, test.Find(key, result));
+        }
+      }
+    }));
+  }
+  std::mt19937 rng(100);
+  std::uniform_int_distribution<int> dist(num_keys / 4, num_keys - 1);
+  for (int i = 0; i < 100000; i++) {
+    int key = dist(rng);
+    if (!test.Remove(key)) {
+      test.Insert(key, key * 2 + 1);
+    }
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+}
+
+// 90% Find, 10% Insert/Remove of a key owned by the thread, as the buffer
+// pool page table sees it
+template <typename Table> double HashOpsPerSecond(Table &table,
+                                                  int num_threads) {
+  const int num_keys = 1024;
+  const int total_ops = 2000000;
+  for (int i = 0; i < num_keys; i++) {
+    table.Insert(i, i);
+  }
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([&table, tid, num_threads]() {
+      std::mt19937 rng(tid);
+      std::uniform_int_distribution<int> dist(0, num_keys - 1);
+      int result;
+      int own_key = num_keys + tid;
+      for (int i = 0; i < total_ops / num_threads; i++) {
+        if (i % 10 == 0) {
+          table.Insert(own_key, i);
+        } else if (i % 10 == 5) {
+          table.Remove(own_key);
+        } else {
+          table.Find(dist(rng), result);
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return total_ops / elapsed.count();
+}
+
+TEST(OpenAddressHashTest, DISABLED_ThroughputBenchmark) {
+  for (int num_threads : {1, 2, 4, 8, 16, 32}) {
+    ExtendibleHash<int, int> extendible_hash(BUCKET_SIZE);
+    OpenAddressHash<int, int> open_address_hash(1024 + num_threads);
+    std::cout << "threads=" << num_threads << " ExtendibleHash ops/sec="
+              << static_cast<long>(HashOpsPerSecond(extendible_hash,
+                                                    num_threads))
+              << " OpenAddressHash ops/sec="
+              << static_cast<long>(HashOpsPerSecond(open_address_hash,
+                                                    num_threads))
+              << std::endl;
+  }
+}
+
+} // namespace cmudb
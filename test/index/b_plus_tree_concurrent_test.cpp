@@ -3,15 +3,18 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <functional>
 #include <iostream>
+#include <random>
 #include <thread>
 
 #include "buffer/buffer_pool_manager.h"
 #include "common/logger.h"
 #include "index/b_plus_tree.h"
+#include "page/header_page.h"
 #include "vtable/virtual_table.h"
 #include "gtest/gtest.h"
 
@@ -151,8 +154,8 @@ TEST(BPlusTreeConcurrentTest, InsertTest1) {
 
   assert(bpm->AllPageUnpined());
 
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -207,8 +210,8 @@ TEST(BPlusTreeConcurrentTest, InsertTest2) {
 
   assert(bpm->AllPageUnpined());
 
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -254,8 +257,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest1) {
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 
   assert(bpm->AllPageUnpined());
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -301,8 +304,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest2) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   assert(bpm->AllPageUnpined());
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -349,8 +352,8 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   assert(bpm->AllPageUnpined());
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -407,10 +410,149 @@ TEST(BPlusTreeConcurrentTest, DeleteTest3) {
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 
   assert(bpm->AllPageUnpined());
+  delete bpm;
   delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// the same keys in databases of different page sizes, with the same amount of
+// buffer pool memory. Larger pages give a higher fanout and a lower tree, a
+// lookup touches fewer pages but searches more entries in each
+TEST(BPlusTreeConcurrentTest, DISABLED_PageSizeBenchmark) {
+  typedef BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>>
+      InternalPage;
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  const int64_t num_keys = 50000;
+  const size_t pool_bytes = 8 << 20;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= num_keys; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+
+  int first_height = 0, height = 0;
+  for (int page_size : {512, 4096, 16384, 65536}) {
+    DiskManager::Options options;
+    options.page_size = page_size;
+    DiskManager *disk_manager = new DiskManager("test.db", options);
+    BufferPoolManager *bpm =
+        new BufferPoolManager(pool_bytes / page_size, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                             comparator);
+    page_id_t page_id;
+    auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+    InsertHelper(tree, keys);
+
+    // down the leftmost path
+    page_id_t node_id;
+    ASSERT_EQ(true, header_page->GetRootId("foo_pk", node_id));
+    height = 1;
+    auto node = reinterpret_cast<BPlusTreePage *>(
+        bpm->FetchPage(node_id)->GetData());
+    while (!node->IsLeafPage()) {
+      page_id_t child_id = reinterpret_cast<InternalPage *>(node)->ValueAt(0);
+      bpm->UnpinPage(node_id, false);
+      node_id = child_id;
+      node = reinterpret_cast<BPlusTreePage *>(
+          bpm->FetchPage(node_id)->GetData());
+      height++;
+    }
+    bpm->UnpinPage(node_id, false);
+    if (first_height == 0) {
+      first_height = height;
+    }
+
+    std::vector<RID> rids;
+    GenericKey<8> index_key;
+    auto start = std::chrono::steady_clock::now();
+    for (auto key : keys) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      tree.GetValue(index_key, rids);
+      EXPECT_EQ(1, rids.size());
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "page size=" << page_size << " height=" << height
+              << " lookup ns=" << elapsed.count() * 1e9 / num_keys << std::endl;
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+  EXPECT_LT(height, first_height);
+  delete key_schema;
+}
+
+
+// a tree in a database opened read only: lookups from many threads and a scan
+// find every key, through pages straight from the mapped db file
+TEST(BPlusTreeConcurrentTest, ReadOnlyTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key < 5000; key++) {
+    keys.push_back(key);
+  }
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  {
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                             comparator);
+    page_id_t page_id;
+    bpm->NewPage(page_id);
+    InsertHelper(tree, keys);
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    bpm->FlushAllPages();
+  }
   delete bpm;
+  delete disk_manager;
+
+  DiskManager::Options options;
+  options.read_only = true;
+  disk_manager = new DiskManager("test.db", options);
+  bpm = new BufferPoolManager(4, disk_manager);
+  auto header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  page_id_t root_id;
+  ASSERT_EQ(true, header_page->GetRootId("foo_pk", root_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+      "foo_pk", bpm, comparator, root_id);
+
+  std::atomic<int> num_found(0);
+  LaunchParallelTest(4, [&](uint64_t) {
+    std::vector<RID> rids;
+    GenericKey<8> index_key;
+    for (auto key : keys) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      if (tree.GetValue(index_key, rids) && rids[0].GetSlotNum() == key) {
+        num_found++;
+      }
+    }
+  });
+  EXPECT_EQ(4 * static_cast<int>(keys.size()), num_found.load());
+
+  int64_t current_key = 1;
+  GenericKey<8> index_key;
+  index_key.SetFromInteger(current_key);
+  for (auto iterator = tree.Begin(index_key); iterator.isEnd() == false;
+       ++iterator) {
+    EXPECT_EQ(current_key, (*iterator).second.GetSlotNum());
+    current_key++;
+  }
+  EXPECT_EQ(static_cast<int64_t>(keys.size()) + 1, current_key);
+  EXPECT_EQ(true, bpm->AllPageUnpined());
+
+  delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
+  delete key_schema;
 }
 
 } // namespace cmudb
@@ -84,8 +84,8 @@ TEST(BPlusInternalPageTest, test) {
     bpm->UnpinPage(p2, true);
     bpm->UnpinPage(p3, true);
     bpm->UnpinPage(p4, true);
-    delete disk_manager;
     delete bpm;
+    delete disk_manager;
 }
 
 }
@@ -1,9 +1,22 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <glob.h>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
+#include "logging/checkpoint_manager.h"
 #include "logging/common.h"
 #include "logging/log_recovery.h"
+#include "page/header_page.h"
 #include "vtable/virtual_table.h"
 #include "gtest/gtest.h"
 
@@ -43,18 +56,228 @@ TEST(LogManagerTest, BasicLogging) {
   // some basic manually checking here
   char buffer[PAGE_SIZE];
   storage_engine->disk_manager_->ReadLog(buffer, PAGE_SIZE, 0);
-  int32_t size = *reinterpret_cast<int32_t *>(buffer);
-  LOG_DEBUG("size  = %d", size);
-  size = *reinterpret_cast<int32_t *>(buffer + 20);
-  LOG_DEBUG("size  = %d", size);
-  size = *reinterpret_cast<int32_t *>(buffer + 44);
-  LOG_DEBUG("size  = %d", size);
+  LogRecord log_record;
+  lsn_t lsn = 0;
+  for (auto type : {LogRecordType::BEGIN, LogRecordType::NEWPAGE,
+                    LogRecordType::INSERT, LogRecordType::MARKDELETE,
+                    LogRecordType::APPLYDELETE, LogRecordType::COMMIT}) {
+    ASSERT_TRUE(log_record.DeserializeFrom(buffer + lsn, PAGE_SIZE - lsn, lsn));
+    LOG_DEBUG("size  = %d", log_record.GetSize());
+    EXPECT_EQ(type, log_record.GetLogRecordType());
+    lsn += log_record.GetSize();
+  }
+  // a record checks out at its own LSN only
+  EXPECT_FALSE(log_record.DeserializeFrom(buffer, PAGE_SIZE, 1));
 
   delete txn;
   delete storage_engine;
   LOG_DEBUG("Teared down the system");
   remove("test.db");
-  remove("test.log");
+  DiskManager::RemoveLogFiles("test.db");
+}
+
+// threads appending many times the log buffer, with and without the flush
+// thread. Appends wait for room in the ring at once; the log has to hold
+// every record, each thread's in the order it appended them
+TEST(LogManagerTest, ConcurrentAppendTest) {
+  const int num_threads = 4;
+  const int num_records = 2000;
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < num_threads; i++) {
+    tuples.push_back(ConstructTuple(schema));
+  }
+
+  for (bool flush_thread : {true, false}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    LogManager *log_manager = new LogManager(disk_manager);
+    if (flush_thread) {
+      log_manager->RunFlushThread();
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&, i] {
+        for (int j = 0; j < num_records; j++) {
+          LogRecord log_record(i, INVALID_LSN, LogRecordType::INSERT,
+                               RID(i, j), tuples[i]);
+          log_manager->AppendLogRecord(log_record);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    if (flush_thread) {
+      log_manager->StopFlushThread();
+    } else {
+      log_manager->Flush(std::numeric_limits<lsn_t>::max());
+    }
+
+    lsn_t log_size = disk_manager->GetLogSize();
+    EXPECT_EQ(log_size, log_manager->GetPersistentLSN() + 1);
+    EXPECT_LT(4 * LOG_RING_SIZE, log_size);
+    std::vector<char> log(log_size);
+    ASSERT_TRUE(disk_manager->ReadLog(log.data(), log_size, 0));
+    std::vector<int> next(num_threads, 0);
+    LogRecord log_record;
+    for (lsn_t lsn = 0; lsn < log_size; lsn += log_record.GetSize()) {
+      ASSERT_TRUE(log_record.DeserializeFrom(
+          log.data() + lsn, static_cast<int>(log_size - lsn), lsn));
+      ASSERT_EQ(LogRecordType::INSERT, log_record.GetLogRecordType());
+      int i = log_record.GetTxnId();
+      ASSERT_LE(0, i);
+      ASSERT_GT(num_threads, i);
+      EXPECT_EQ(RID(i, next[i]), log_record.GetInsertRID());
+      Tuple &tuple = log_record.GetInserteTuple();
+      ASSERT_EQ(tuples[i].GetLength(), tuple.GetLength());
+      EXPECT_EQ(0, memcmp(tuples[i].GetData(), tuple.GetData(),
+                          tuple.GetLength()));
+      next[i]++;
+    }
+    for (int i = 0; i < num_threads; i++) {
+      EXPECT_EQ(num_records, next[i]);
+    }
+
+    delete log_manager;
+    delete disk_manager;
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+    remove("test.fsm");
+  }
+  delete schema;
+}
+
+// transactions that insert a tuple and commit, from a growing number of
+// threads. A commit waits for its record to be on disk, the commits of the
+// other threads coming meanwhile share the next log write
+TEST(LogManagerTest, DISABLED_GroupCommitBenchmark) {
+  const auto duration = std::chrono::milliseconds(500);
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple = ConstructTuple(schema);
+
+  for (int num_threads : {1, 2, 4, 8, 16}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    LogManager *log_manager = new LogManager(disk_manager);
+    // big enough for the table, only log writes are measured
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(1024, disk_manager, log_manager);
+    LockManager *lock_manager = new LockManager(true);
+    TransactionManager *transaction_manager =
+        new TransactionManager(lock_manager, log_manager);
+    log_manager->RunFlushThread();
+    Transaction *txn = transaction_manager->Begin();
+    TableHeap *table =
+        new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+    transaction_manager->Commit(txn);
+    delete txn;
+    int flushes_before = disk_manager->GetNumFlushes();
+
+    std::atomic<long> num_commits(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&] {
+        RID rid;
+        while (std::chrono::steady_clock::now() - start < duration) {
+          Transaction *txn = transaction_manager->Begin();
+          EXPECT_TRUE(table->InsertTuple(tuple, rid, txn));
+          transaction_manager->Commit(txn);
+          delete txn;
+          num_commits++;
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    int num_flushes = disk_manager->GetNumFlushes() - flushes_before;
+    EXPECT_LT(0, num_flushes);
+    std::cout << "threads=" << num_threads << " commits/sec="
+              << static_cast<long>(num_commits / elapsed.count())
+              << " commits per log write="
+              << static_cast<double>(num_commits) / num_flushes << std::endl;
+
+    log_manager->StopFlushThread();
+    delete table;
+    delete transaction_manager;
+    delete lock_manager;
+    delete buffer_pool_manager;
+    delete log_manager;
+    delete disk_manager;
+    remove("test.db");
+    DiskManager::RemoveLogFiles("test.db");
+    remove("test.fsm");
+  }
+  delete schema;
+}
+
+// threads appending records as fast as they can, with appends reserving
+// their room in the log buffer and copying in parallel, and with appends
+// serialized on a latch around them. The flush thread writes the log
+// meanwhile, to a memory file system if there is one, so that syncs do not
+// set the pace
+TEST(LogManagerTest, DISABLED_AppendBenchmark) {
+  const auto duration = std::chrono::milliseconds(200);
+  const std::string name =
+      access("/dev/shm", W_OK) == 0 ? "/dev/shm/append_test" : "test";
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple = ConstructTuple(schema);
+
+  for (bool latched : {true, false}) {
+    for (int num_threads : {1, 2, 4, 8, 16, 32}) {
+      DiskManager *disk_manager = new DiskManager(name + ".db");
+      LogManager *log_manager = new LogManager(disk_manager);
+      log_manager->RunFlushThread();
+      std::mutex append_latch;
+
+      std::atomic<long> num_appends(0);
+      auto start = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&, i] {
+          LogRecord log_record(i, INVALID_LSN, LogRecordType::INSERT,
+                               RID(i, 0), tuple);
+          long appends = 0;
+          while (std::chrono::steady_clock::now() - start < duration) {
+            for (int j = 0; j < 64; j++) {
+              if (latched) {
+                std::lock_guard<std::mutex> guard(append_latch);
+                log_manager->AppendLogRecord(log_record);
+              } else {
+                log_manager->AppendLogRecord(log_record);
+              }
+            }
+            appends += 64;
+          }
+          num_appends += appends;
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      log_manager->StopFlushThread();
+      // every record is on disk, one after the other
+      EXPECT_EQ(disk_manager->GetLogSize(),
+                log_manager->GetPersistentLSN() + 1);
+      std::cout << (latched ? "latched" : "reserved")
+                << " threads=" << num_threads << " appends/sec="
+                << static_cast<long>(num_appends / elapsed.count())
+                << " bytes per log write="
+                << disk_manager->GetLogSize() / disk_manager->GetNumFlushes()
+                << std::endl;
+
+      delete log_manager;
+      delete disk_manager;
+      remove((name + ".db").c_str());
+      DiskManager::RemoveLogFiles(name + ".db");
+      remove((name + ".fsm").c_str());
+    }
+  }
+  delete schema;
 }
 
 // actually LogRecovery
@@ -121,7 +344,539 @@ TEST(LogManagerTest, RedoTestWithOneTxn) {
   delete storage_engine;
   LOG_DEBUG("Teared down the system");
   remove("test.db");
-  remove("test.log");
+  DiskManager::RemoveLogFiles("test.db");
+}
+
+// the changes of a transaction that did not commit are on disk at the crash
+// (the buffer pool wrote them), recovery has to roll them back. It logs the
+// rollback, so that recovering again after a crash during recovery gives the
+// same result
+TEST(LogManagerTest, UndoTestWithUncommittedTxn) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  storage_engine->log_manager_->RunFlushThread();
+
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple_a = ConstructTuple(schema);
+  Tuple tuple_b = ConstructTuple(schema);
+  Tuple tuple_c = ConstructTuple(schema);
+  Tuple tuple_d = ConstructTuple(schema);
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID rid_a, rid_b, rid_c, rid_d;
+  EXPECT_TRUE(test_table->InsertTuple(tuple_a, rid_a, txn));
+  EXPECT_TRUE(test_table->InsertTuple(tuple_b, rid_b, txn));
+  EXPECT_TRUE(test_table->InsertTuple(tuple_c, rid_c, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->InsertTuple(tuple_d, rid_d, txn));
+  EXPECT_TRUE(test_table->MarkDelete(rid_a, txn));
+  EXPECT_TRUE(test_table->UpdateTuple(tuple_d, rid_b, txn));
+  storage_engine->buffer_pool_manager_->FlushAllPages();
+  delete txn;
+  delete test_table;
+
+  // crash twice: before recovery and after it, before any page is written
+  for (int restart = 0; restart < 2; restart++) {
+    delete storage_engine;
+    storage_engine = new StorageEngine("test.db");
+    LogRecovery *log_recovery = new LogRecovery(
+        storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+        storage_engine->log_manager_);
+    log_recovery->Redo();
+    log_recovery->Undo();
+    delete log_recovery;
+
+    txn = storage_engine->transaction_manager_->Begin();
+    test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                               storage_engine->lock_manager_,
+                               storage_engine->log_manager_, first_page_id);
+    Tuple tuple;
+    for (auto &expected : {std::make_pair(rid_a, &tuple_a),
+                           std::make_pair(rid_b, &tuple_b),
+                           std::make_pair(rid_c, &tuple_c)}) {
+      ASSERT_TRUE(test_table->GetTuple(expected.first, tuple, txn));
+      ASSERT_EQ(expected.second->GetLength(), tuple.GetLength());
+      EXPECT_EQ(0, memcmp(expected.second->GetData(), tuple.GetData(),
+                          tuple.GetLength()));
+    }
+    EXPECT_FALSE(test_table->GetTuple(rid_d, tuple, txn));
+    delete txn;
+    delete test_table;
+  }
+
+  delete storage_engine;
+  delete schema;
+  remove("test.db");
+  DiskManager::RemoveLogFiles("test.db");
+  remove("test.fsm");
+}
+
+// the records of the log, up to the first one that does not check out
+std::vector<LogRecord> ReadLogRecords(DiskManager *disk_manager) {
+  std::vector<char> log(disk_manager->GetLogSize());
+  std::vector<LogRecord> records;
+  if (!disk_manager->ReadLog(log.data(), log.size(), 0)) {
+    return records;
+  }
+  LogRecord log_record;
+  for (lsn_t lsn = 0; log_record.DeserializeFrom(
+           log.data() + lsn, static_cast<int>(log.size() - lsn), lsn);
+       lsn += log_record.GetSize()) {
+    records.push_back(log_record);
+  }
+  return records;
+}
+
+// a crash halfway through undo: the log holds the CLRs of the records undone
+// so far, but no ABORT record. The next recovery redoes them and undoes only
+// the records they do not compensate yet, each change is rolled back once
+TEST(LogManagerTest, UndoCrashTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  storage_engine->log_manager_->RunFlushThread();
+
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple_a = ConstructTuple(schema);
+  Tuple tuple_b = ConstructTuple(schema);
+  Tuple tuple_c = ConstructTuple(schema);
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID rid_a, rid_b, rid_c, rid_d;
+  EXPECT_TRUE(test_table->InsertTuple(tuple_a, rid_a, txn));
+  EXPECT_TRUE(test_table->InsertTuple(tuple_b, rid_b, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // four changes of a transaction that does not commit
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->InsertTuple(tuple_c, rid_c, txn));
+  EXPECT_TRUE(test_table->InsertTuple(tuple_c, rid_d, txn));
+  EXPECT_TRUE(test_table->MarkDelete(rid_a, txn));
+  EXPECT_TRUE(test_table->UpdateTuple(tuple_c, rid_b, txn));
+  storage_engine->buffer_pool_manager_->FlushAllPages();
+  delete txn;
+  delete test_table;
+  delete storage_engine;
+
+  auto recover = [&]() {
+    storage_engine = new StorageEngine("test.db");
+    LogRecovery *log_recovery = new LogRecovery(
+        storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+        storage_engine->log_manager_);
+    log_recovery->Redo();
+    log_recovery->Undo();
+    delete log_recovery;
+  };
+  auto count = [](std::vector<LogRecord> &records, LogRecordType type) {
+    return std::count_if(records.begin(), records.end(), [type](LogRecord &r) {
+      return r.GetLogRecordType() == type;
+    });
+  };
+
+  // recover, then crash before any page is written, and drop the log after
+  // the second CLR
+  recover();
+  delete storage_engine;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::vector<LogRecord> records = ReadLogRecords(disk_manager);
+  EXPECT_EQ(4, count(records, LogRecordType::CLR));
+  EXPECT_EQ(1, count(records, LogRecordType::ABORT));
+  lsn_t log_size = 0;
+  for (size_t i = 0, clrs = 0; clrs < 2; i++) {
+    if (records[i].GetLogRecordType() == LogRecordType::CLR) {
+      clrs++;
+    }
+    log_size += records[i].GetSize();
+  }
+  disk_manager->TruncateLog(log_size);
+  delete disk_manager;
+
+  recover();
+  txn = storage_engine->transaction_manager_->Begin();
+  test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                             storage_engine->lock_manager_,
+                             storage_engine->log_manager_, first_page_id);
+  Tuple tuple;
+  for (auto &expected :
+       {std::make_pair(rid_a, &tuple_a), std::make_pair(rid_b, &tuple_b)}) {
+    ASSERT_TRUE(test_table->GetTuple(expected.first, tuple, txn));
+    ASSERT_EQ(expected.second->GetLength(), tuple.GetLength());
+    EXPECT_EQ(0, memcmp(expected.second->GetData(), tuple.GetData(),
+                        tuple.GetLength()));
+  }
+  EXPECT_FALSE(test_table->GetTuple(rid_c, tuple, txn));
+  EXPECT_FALSE(test_table->GetTuple(rid_d, tuple, txn));
+  delete txn;
+  delete test_table;
+  delete storage_engine;
+
+  // the two CLRs left are not undone, the two records they do not cover get
+  // theirs
+  disk_manager = new DiskManager("test.db");
+  records = ReadLogRecords(disk_manager);
+  EXPECT_EQ(4, count(records, LogRecordType::CLR));
+  EXPECT_EQ(1, count(records, LogRecordType::ABORT));
+  delete disk_manager;
+
+  delete schema;
+  remove("test.db");
+  DiskManager::RemoveLogFiles("test.db");
+  remove("test.fsm");
+}
+
+// recovery of a log of many small update transactions, most of whose changes
+// were not written to the db file, with the redo records replayed by one
+// thread and by RECOVERY_THREADS workers. Neither the db file nor the log is
+// in the OS page cache when recovery starts
+TEST(LogManagerTest, DISABLED_ParallelRedoBenchmark) {
+  const int num_tuples = 4000;
+  const int num_updates = 40000;
+  const int updates_per_txn = 100;
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(64, disk_manager, log_manager);
+  LockManager *lock_manager = new LockManager(true);
+  TransactionManager *transaction_manager =
+      new TransactionManager(lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  Transaction *txn = transaction_manager->Begin();
+  TableHeap *table =
+      new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+  page_id_t first_page_id = table->GetFirstPageId();
+  std::vector<RID> rids(num_tuples);
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < num_tuples; i++) {
+    tuples.push_back(ConstructTuple(schema));
+    EXPECT_TRUE(table->InsertTuple(tuples[i], rids[i], txn));
+  }
+  transaction_manager->Commit(txn);
+  delete txn;
+
+  for (int i = 0; i < num_updates; i += updates_per_txn) {
+    txn = transaction_manager->Begin();
+    for (int j = 0; j < updates_per_txn; j++) {
+      int k = rand() % num_tuples;
+      Tuple tuple = ConstructTuple(schema);
+      // fails when the page has no room for a longer tuple
+      if (table->UpdateTuple(tuple, rids[k], txn)) {
+        tuples[k] = tuple;
+      }
+    }
+    transaction_manager->Commit(txn);
+    delete txn;
+  }
+  log_manager->StopFlushThread();
+  lsn_t log_size = disk_manager->GetLogSize();
+  // crash, the pages left in the buffer pool are lost
+  delete table;
+  delete transaction_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete disk_manager;
+
+  for (size_t num_threads : {static_cast<size_t>(1),
+                             static_cast<size_t>(RECOVERY_THREADS)}) {
+    glob_t log_files;
+    ASSERT_EQ(0, glob("test.log.*", 0, nullptr, &log_files));
+    std::vector<std::string> names(log_files.gl_pathv,
+                                   log_files.gl_pathv + log_files.gl_pathc);
+    globfree(&log_files);
+    names.push_back("test.db");
+    for (auto &name : names) {
+      int fd = open(name.c_str(), O_RDONLY);
+      ASSERT_LE(0, fd);
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+    }
+
+    // holds every page, so that nothing recovered is written and the next
+    // round starts from the same files
+    disk_manager = new DiskManager("test.db");
+    buffer_pool_manager = new BufferPoolManager(1024, disk_manager);
+    auto start = std::chrono::steady_clock::now();
+    LogRecovery *log_recovery = new LogRecovery(
+        disk_manager, buffer_pool_manager, nullptr, num_threads);
+    log_recovery->Redo();
+    log_recovery->Undo();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    delete log_recovery;
+
+    txn = new Transaction(0);
+    table = new TableHeap(buffer_pool_manager, nullptr, nullptr, first_page_id);
+    Tuple tuple;
+    for (int i = 0; i < num_tuples; i++) {
+      ASSERT_TRUE(table->GetTuple(rids[i], tuple, txn));
+      ASSERT_EQ(tuples[i].GetLength(), tuple.GetLength());
+      EXPECT_EQ(0, memcmp(tuples[i].GetData(), tuple.GetData(),
+                          tuple.GetLength()));
+    }
+    std::cout << "redo threads=" << num_threads
+              << " log bytes=" << log_size << " recovery ms="
+              << static_cast<long>(elapsed.count() * 1000) << std::endl;
+    delete table;
+    delete txn;
+    delete buffer_pool_manager;
+    delete disk_manager;
+  }
+
+  delete schema;
+  remove("test.db");
+  DiskManager::RemoveLogFiles("test.db");
+  remove("test.fsm");
+}
+
+// update transactions on a table of fixed size tuples that change one column
+// at a time, so that their records log the changed bytes only. The last
+// transaction does not commit and its changes are on disk: recovery redoes
+// and undoes records holding deltas
+TEST(LogManagerTest, UpdateLogVolumeTest) {
+  const int num_tuples = 1000;
+  const int num_txns = 1000;
+  const int updates_per_txn = 10;
+  Schema *schema = ParseCreateStatement("a smallint, b bigint, c integer");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(64, disk_manager, log_manager);
+  LockManager *lock_manager = new LockManager(true);
+  TransactionManager *transaction_manager =
+      new TransactionManager(lock_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  Transaction *txn = transaction_manager->Begin();
+  TableHeap *table =
+      new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+  page_id_t first_page_id = table->GetFirstPageId();
+  std::vector<RID> rids(num_tuples);
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < num_tuples; i++) {
+    tuples.push_back(ConstructTuple(schema));
+    EXPECT_TRUE(table->InsertTuple(tuples[i], rids[i], txn));
+  }
+  transaction_manager->Commit(txn);
+  delete txn;
+  // a commit returns once the log is on disk up to its end
+  lsn_t updates_start = log_manager->GetPersistentLSN() + 1;
+
+  auto update = [&](int k) {
+    std::vector<Value> values;
+    for (int i = 0; i < schema->GetColumnCount(); i++) {
+      values.push_back(tuples[k].GetValue(schema, i));
+    }
+    values[1] = Value(TypeId::BIGINT, static_cast<int64_t>(rand()));
+    Tuple tuple(values, schema);
+    EXPECT_TRUE(table->UpdateTuple(tuple, rids[k], txn));
+    return tuple;
+  };
+  for (int i = 0; i < num_txns; i++) {
+    txn = transaction_manager->Begin();
+    for (int j = 0; j < updates_per_txn; j++) {
+      int k = rand() % num_tuples;
+      tuples[k] = update(k);
+    }
+    transaction_manager->Commit(txn);
+    delete txn;
+  }
+  lsn_t wal_bytes = log_manager->GetPersistentLSN() + 1 - updates_start;
+  // BEGIN and COMMIT with 28 byte headers, UPDATE records with both images
+  long fixed_bytes =
+      static_cast<long>(num_txns) *
+      (2 * 28 + updates_per_txn * (28 + 8 + 2 * (4 + tuples[0].GetLength())));
+  EXPECT_LT(wal_bytes, fixed_bytes);
+
+  txn = transaction_manager->Begin();
+  for (int k = 0; k < updates_per_txn; k++) {
+    update(k);
+  }
+  buffer_pool_manager->FlushAllPages();
+  log_manager->StopFlushThread();
+  // crash, the pages left in the buffer pool are lost
+  delete txn;
+  delete table;
+  delete transaction_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  buffer_pool_manager = new BufferPoolManager(64, disk_manager);
+  LogRecovery *log_recovery =
+      new LogRecovery(disk_manager, buffer_pool_manager);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = new Transaction(0);
+  table = new TableHeap(buffer_pool_manager, nullptr, nullptr, first_page_id);
+  Tuple tuple;
+  for (int i = 0; i < num_tuples; i++) {
+    ASSERT_TRUE(table->GetTuple(rids[i], tuple, txn));
+    ASSERT_EQ(tuples[i].GetLength(), tuple.GetLength());
+    EXPECT_EQ(0, memcmp(tuples[i].GetData(), tuple.GetData(),
+                        tuple.GetLength()));
+  }
+  delete table;
+  delete txn;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  DiskManager::RemoveLogFiles("test.db");
+  remove("test.fsm");
+}
+
+
+// recovery after two fuzzy checkpoints, one of them taken while a
+// transaction that never commits is running. The second checkpoint writes
+// the pages dirty since before the first, so the log segments before the
+// first are not needed any more: they are discarded
+TEST(LogManagerTest, CheckpointTest) {
+  const int num_tuples = 2000;
+  const int num_updates = 5000;
+  const int updates_per_txn = 50;
+  const int segment_size = 64 * 1024;
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+
+  DiskManager::Options options;
+  options.log_segment_size = segment_size;
+  DiskManager *disk_manager = new DiskManager("test.db", options);
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(64, disk_manager, log_manager);
+  LockManager *lock_manager = new LockManager(true);
+  TransactionManager *transaction_manager =
+      new TransactionManager(lock_manager, log_manager);
+  CheckpointManager *checkpoint_manager =
+      new CheckpointManager(buffer_pool_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  page_id_t header_page_id;
+  auto header_page =
+      static_cast<HeaderPage *>(buffer_pool_manager->NewPage(header_page_id));
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  header_page->Init();
+  buffer_pool_manager->UnpinPage(header_page_id, true);
+
+  Transaction *txn = transaction_manager->Begin();
+  TableHeap *table =
+      new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+  page_id_t first_page_id = table->GetFirstPageId();
+  std::vector<RID> rids(num_tuples);
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < num_tuples; i++) {
+    tuples.push_back(ConstructTuple(schema));
+    EXPECT_TRUE(table->InsertTuple(tuples[i], rids[i], txn));
+  }
+  transaction_manager->Commit(txn);
+  delete txn;
+
+  // the loser updates tuples 0 and 1, committed transactions the others
+  auto run_updates = [&]() {
+    for (int i = 0; i < num_updates; i += updates_per_txn) {
+      Transaction *txn = transaction_manager->Begin();
+      for (int j = 0; j < updates_per_txn; j++) {
+        int k = 2 + rand() % (num_tuples - 2);
+        Tuple tuple = ConstructTuple(schema);
+        // fails when the page has no room for a longer tuple
+        if (table->UpdateTuple(tuple, rids[k], txn)) {
+          tuples[k] = tuple;
+        }
+      }
+      transaction_manager->Commit(txn);
+      delete txn;
+    }
+  };
+  run_updates();
+  lsn_t first_checkpoint = checkpoint_manager->Checkpoint();
+
+  // the loser keeps the size of the tuples it updates. Undo puts the old
+  // ones back in place, a longer one may not fit once committed updates
+  // filled the page
+  auto loser_tuple = [&](int k) {
+    Tuple tuple = ConstructTuple(schema);
+    while (tuple.GetLength() != tuples[k].GetLength()) {
+      tuple = ConstructTuple(schema);
+    }
+    return tuple;
+  };
+  Transaction *loser = transaction_manager->Begin();
+  EXPECT_TRUE(table->UpdateTuple(loser_tuple(0), rids[0], loser));
+  run_updates();
+  lsn_t second_checkpoint = checkpoint_manager->Checkpoint();
+  EXPECT_LT(first_checkpoint, second_checkpoint);
+  lsn_t log_start = disk_manager->GetLogStart();
+  EXPECT_LE(first_checkpoint / segment_size * segment_size, log_start);
+  EXPECT_LT(log_start, second_checkpoint);
+  EXPECT_TRUE(table->UpdateTuple(loser_tuple(1), rids[1], loser));
+  run_updates();
+
+  log_manager->StopFlushThread();
+  // crash, the pages left in the buffer pool are lost
+  delete loser;
+  delete table;
+  delete checkpoint_manager;
+  delete transaction_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete disk_manager;
+
+  // the segments before log_start are gone, the segment size is that of the
+  // existing log
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(segment_size, disk_manager->GetLogSegmentSize());
+  EXPECT_EQ(log_start, disk_manager->GetLogStart());
+  char buffer[PAGE_SIZE];
+  EXPECT_FALSE(disk_manager->ReadLog(buffer, PAGE_SIZE, 0));
+  log_manager = new LogManager(disk_manager);
+  buffer_pool_manager = new BufferPoolManager(1024, disk_manager, log_manager);
+  header_page =
+      static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
+  EXPECT_EQ(second_checkpoint, header_page->GetCheckpointLSN());
+  buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+
+  LogRecovery *log_recovery =
+      new LogRecovery(disk_manager, buffer_pool_manager, log_manager);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = new Transaction(0);
+  table = new TableHeap(buffer_pool_manager, nullptr, nullptr, first_page_id);
+  Tuple tuple;
+  for (int i = 0; i < num_tuples; i++) {
+    ASSERT_TRUE(table->GetTuple(rids[i], tuple, txn));
+    ASSERT_EQ(tuples[i].GetLength(), tuple.GetLength());
+    EXPECT_EQ(0, memcmp(tuples[i].GetData(), tuple.GetData(),
+                        tuple.GetLength()));
+  }
+  delete table;
+  delete txn;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete disk_manager;
+
+  delete schema;
+  remove("test.db");
+  DiskManager::RemoveLogFiles("test.db");
+  remove("test.fsm");
 }
 
 } // namespace cmudb
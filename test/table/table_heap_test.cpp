@@ -0,0 +1,443 @@
+/**
+ * table_heap_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/lz4.h"
+#include "logging/common.h"
+#include "table/table_heap.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// a full scan through a ring must still see every tuple
+TEST(TableHeapTest, ScanWithStrategyTest) {
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple = ConstructTuple(schema);
+
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(20, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  RID rid;
+  std::vector<RID> rid_v;
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(true, table->InsertTuple(tuple, rid, transaction));
+    rid_v.push_back(rid);
+  }
+
+  BufferAccessStrategy strategy;
+  size_t i = 0;
+  for (auto itr = table->begin(transaction, &strategy); itr != table->end();
+       ++itr) {
+    ASSERT_LT(i, rid_v.size());
+    EXPECT_EQ(rid_v[i].Get(), itr->GetRid().Get());
+    i++;
+  }
+  EXPECT_EQ(rid_v.size(), i);
+  EXPECT_EQ(true, buffer_pool_manager->AllPageUnpined());
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+}
+
+// scan a table that is not in memory, neither in the buffer pool nor in the
+// OS page cache, with and without read ahead
+TEST(TableHeapTest, DISABLED_ColdScanBenchmark) {
+  const int num_tuples = 6000;
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple = ConstructTuple(schema);
+
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // inserts walk the whole heap, load it with every page in memory
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(1024, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  RID rid;
+  for (int i = 0; i < num_tuples; ++i) {
+    table->InsertTuple(tuple, rid, transaction);
+  }
+  page_id_t first_page_id = table->GetFirstPageId();
+  buffer_pool_manager->FlushAllPages();
+  delete table;
+  delete buffer_pool_manager;
+
+  for (int window : {0, READ_AHEAD_WINDOW}) {
+    int fd = open("test.db", O_RDONLY);
+    ASSERT_LE(0, fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+
+    buffer_pool_manager = new BufferPoolManager(64, disk_manager);
+    buffer_pool_manager->SetReadAheadWindow(window);
+    table = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                          first_page_id);
+    int count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto itr = table->begin(transaction); itr != table->end(); ++itr) {
+      count++;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(num_tuples, count);
+    std::cout << "read ahead window=" << window
+              << " tuples/sec=" << static_cast<long>(count / elapsed.count())
+              << " pages read by the scan="
+              << buffer_pool_manager->GetNumMisses() << " prefetched pages="
+              << buffer_pool_manager->GetNumPrefetches() << std::endl;
+    delete table;
+    delete buffer_pool_manager;
+  }
+
+  delete log_manager;
+  delete lock_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+}
+
+// scans of a table whose pages are in the OS page cache but mostly not in
+// the buffer pool, which copies every page it reads, and of the same table
+// opened read only, which reads the pages where they are mapped
+TEST(TableHeapTest, DISABLED_ReadOnlyScanBenchmark) {
+  const int num_tuples = 10000;
+  const int num_scans = 5;
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple = ConstructTuple(schema);
+
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(4096, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  RID rid;
+  for (int i = 0; i < num_tuples; ++i) {
+    table->InsertTuple(tuple, rid, transaction);
+  }
+  page_id_t first_page_id = table->GetFirstPageId();
+  buffer_pool_manager->FlushAllPages();
+  delete table;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete disk_manager;
+
+  for (bool read_only : {false, true}) {
+    DiskManager::Options options;
+    options.read_only = read_only;
+    disk_manager = new DiskManager("test.db", options);
+    log_manager = new LogManager(disk_manager);
+    buffer_pool_manager = new BufferPoolManager(64, disk_manager);
+    table = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                          first_page_id);
+    int count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int scan = 0; scan < num_scans; scan++) {
+      for (auto itr = table->begin(transaction); itr != table->end(); ++itr) {
+        count++;
+      }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(num_scans * num_tuples, count);
+    EXPECT_EQ(true, buffer_pool_manager->AllPageUnpined());
+    std::cout << (read_only ? "read only: " : "buffer pool: ")
+              << "tuples/sec=" << static_cast<long>(count / elapsed.count())
+              << " pages copied="
+              << buffer_pool_manager->GetNumMisses() +
+                     buffer_pool_manager->GetNumPrefetches()
+              << std::endl;
+    delete table;
+    delete buffer_pool_manager;
+    delete log_manager;
+    delete disk_manager;
+  }
+
+  delete lock_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// two tables growing at the same time, page by page and with extents: how
+// often the page chain of one of them jumps in the file, and how fast it scans
+// when nothing is cached. Read ahead of the buffer pool is off, only the OS
+// reads ahead, and only helps if the next pages in the file are the table's
+TEST(TableHeapTest, DISABLED_FragmentationBenchmark) {
+  const int num_tuples = 3000;
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple = ConstructTuple(schema);
+  Transaction *transaction = new Transaction(0);
+  LockManager *lock_manager = new LockManager(true);
+
+  for (int extent_size : {1, EXTENT_SIZE}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    LogManager *log_manager = new LogManager(disk_manager);
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(1024, disk_manager);
+    TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                     log_manager, transaction, extent_size);
+    TableHeap *other = new TableHeap(buffer_pool_manager, lock_manager,
+                                     log_manager, transaction, extent_size);
+    RID rid;
+    for (int i = 0; i < num_tuples; ++i) {
+      table->InsertTuple(tuple, rid, transaction);
+      other->InsertTuple(tuple, rid, transaction);
+    }
+    page_id_t first_page_id = table->GetFirstPageId();
+    int num_pages = 0, num_runs = 0;
+    page_id_t prev_page_id = INVALID_PAGE_ID;
+    for (auto itr = table->begin(transaction); itr != table->end(); ++itr) {
+      page_id_t page_id = itr->GetRid().GetPageId();
+      if (page_id != prev_page_id) {
+        num_pages++;
+        if (prev_page_id == INVALID_PAGE_ID || page_id != prev_page_id + 1) {
+          num_runs++;
+        }
+        prev_page_id = page_id;
+      }
+    }
+    buffer_pool_manager->FlushAllPages();
+    delete other;
+    delete table;
+    delete buffer_pool_manager;
+
+    int fd = open("test.db", O_RDONLY);
+    ASSERT_LE(0, fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    buffer_pool_manager = new BufferPoolManager(64, disk_manager);
+    buffer_pool_manager->SetReadAheadWindow(0);
+    table = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                          first_page_id);
+    int count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto itr = table->begin(transaction); itr != table->end(); ++itr) {
+      count++;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(num_tuples, count);
+    if (extent_size > 1) {
+      EXPECT_GE(num_pages / EXTENT_SIZE + 1, num_runs);
+    }
+    std::cout << "extent size=" << extent_size << " pages=" << num_pages
+              << " contiguous runs=" << num_runs << " cold scan tuples/sec="
+              << static_cast<long>(count / elapsed.count())
+              << " pages read by the scan="
+              << buffer_pool_manager->GetNumMisses() << std::endl;
+    delete table;
+    delete buffer_pool_manager;
+    delete log_manager;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete lock_manager;
+  delete transaction;
+  delete schema;
+}
+
+// point lookups on a hot set of pages, while the same thread keeps scanning a
+// table much larger than the buffer pool. The hot set fits in the pool, but
+// not together with the pages the scan reads between two lookups of the same
+// hot page. Returns the hit ratio of the point lookups
+double ScanWhileOLTP(bool use_strategy) {
+  const int pool_size = 64;
+  const int num_tuples = 3000;
+  const size_t num_hot_pages = 48;
+  const int lookup_interval = 16; // scanned tuples per point lookup
+  const int num_scans = 3;
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple = ConstructTuple(schema);
+
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(pool_size, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  RID rid;
+  std::vector<RID> hot_rids;
+  for (int i = 0; i < num_tuples; ++i) {
+    table->InsertTuple(tuple, rid, transaction);
+    // one tuple of every other page
+    if (rid.GetSlotNum() == 0 && rid.GetPageId() % 2 == 0 &&
+        hot_rids.size() < num_hot_pages) {
+      hot_rids.push_back(rid);
+    }
+  }
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<size_t> dist(0, hot_rids.size() - 1);
+  size_t lookups = 0, lookup_hits = 0;
+  for (int scan = 0; scan < num_scans; scan++) {
+    BufferAccessStrategy strategy;
+    for (auto itr = table->begin(transaction,
+                                 use_strategy ? &strategy : nullptr);
+         itr != table->end(); ++itr) {
+      if (itr->GetRid().GetSlotNum() % lookup_interval != 0) {
+        continue;
+      }
+      Tuple result;
+      size_t before = buffer_pool_manager->GetNumHits();
+      table->GetTuple(hot_rids[dist(rng)], result, transaction);
+      lookups++;
+      lookup_hits += buffer_pool_manager->GetNumHits() - before;
+    }
+  }
+
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete schema;
+  remove("test.db");
+  return static_cast<double>(lookup_hits) / lookups;
+}
+
+TEST(TableHeapTest, ScanWhileOLTPTest) {
+  EXPECT_GT(ScanWhileOLTP(true), ScanWhileOLTP(false));
+}
+
+// the same table stored plain and LZ4 compressed: bytes written by a flush
+// and read by a cold scan, and what it costs in CPU to compress and
+// decompress a page
+TEST(TableHeapTest, DISABLED_CompressionBenchmark) {
+  const int num_tuples = 30000;
+  const int page_size = 4096;
+  Schema *schema = ParseCreateStatement("a smallint, b integer, c bigint");
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < 64; i++) {
+    tuples.push_back(ConstructTuple(schema));
+  }
+  Transaction *transaction = new Transaction(0);
+  LockManager *lock_manager = new LockManager(true);
+  size_t plain_bytes_read = 0;
+
+  for (bool compress : {false, true}) {
+    remove("test.db");
+    remove("test.map");
+    DiskManager::Options options;
+    options.page_size = page_size;
+    options.compress = compress;
+    DiskManager *disk_manager = new DiskManager("test.db", options);
+    LogManager *log_manager = new LogManager(disk_manager);
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(1024, disk_manager);
+    TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                     log_manager, transaction);
+    RID rid;
+    for (int i = 0; i < num_tuples; ++i) {
+      table->InsertTuple(tuples[i % tuples.size()], rid, transaction);
+    }
+    page_id_t first_page_id = table->GetFirstPageId();
+
+    // a full page of the table, compressed and decompressed in memory
+    std::vector<char> compressed(page_size), decompressed(page_size);
+    Page *page = buffer_pool_manager->FetchPage(first_page_id);
+    const int rounds = 1000;
+    int compressed_size = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      compressed_size = LZ4Compress(page->GetData(), page_size,
+                                    compressed.data(), page_size);
+    }
+    std::chrono::duration<double> compress_time =
+        std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      EXPECT_EQ(page_size, LZ4Decompress(compressed.data(), compressed_size,
+                                         decompressed.data(), page_size));
+    }
+    std::chrono::duration<double> decompress_time =
+        std::chrono::steady_clock::now() - start;
+    buffer_pool_manager->UnpinPage(first_page_id, false);
+
+    start = std::chrono::steady_clock::now();
+    buffer_pool_manager->FlushAllPages();
+    disk_manager->SyncDB();
+    std::chrono::duration<double> flush_time =
+        std::chrono::steady_clock::now() - start;
+    size_t bytes_written = disk_manager->GetNumBytesWritten();
+    delete table;
+    delete buffer_pool_manager;
+
+    int fd = open("test.db", O_RDONLY);
+    ASSERT_LE(0, fd);
+    off_t file_size = lseek(fd, 0, SEEK_END);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    size_t bytes_read = disk_manager->GetNumBytesRead();
+    buffer_pool_manager = new BufferPoolManager(64, disk_manager);
+    table = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                          first_page_id);
+    int count = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto itr = table->begin(transaction); itr != table->end(); ++itr) {
+      count++;
+    }
+    std::chrono::duration<double> scan_time =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(num_tuples, count);
+    bytes_read = disk_manager->GetNumBytesRead() - bytes_read;
+    if (compress) {
+      EXPECT_GT(plain_bytes_read, bytes_read);
+    } else {
+      plain_bytes_read = bytes_read;
+    }
+    std::cout << (compress ? "compressed" : "plain") << ": file bytes="
+              << file_size << " bytes written by flush=" << bytes_written
+              << " flush seconds=" << flush_time.count()
+              << " bytes read by cold scan=" << bytes_read
+              << " scan seconds=" << scan_time.count()
+              << " page compressed to=" << compressed_size
+              << " compress us/page=" << compress_time.count() * 1e6 / rounds
+              << " decompress us/page="
+              << decompress_time.count() * 1e6 / rounds << std::endl;
+    delete table;
+    delete buffer_pool_manager;
+    delete log_manager;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.map");
+    remove("test.log");
+  }
+  delete lock_manager;
+  delete transaction;
+  delete schema;
+}
+
+} // namespace cmudb